@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fnmatch.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+namespace fs = std::filesystem;
+
+// Пакетная обработка изображений без окон: поиск областей в каждом файле
+// и запись прямоугольников в формате JSON Lines или CSV.
+//
+//   batch [--threads N] [--format jsonl|csv] [--output FILE] [--annotate DIR]
+//         [--list FILE] [ВХОД...]
+//
+// ВХОД - каталог (файлы изображений в нём), шаблон имени вида "dir/*.jpg"
+// или отдельный файл. --list FILE - файл со списком путей, по одному в строке
+// ("-" - стандартный ввод). Изображения обрабатываются параллельно, на каждый
+// поток - свой RegionDetector; записи выводятся по мере готовности.
+// --annotate DIR - копии изображений с прямоугольниками; к имени файла
+// добавляется его номер в списке, чтобы одинаковые имена из разных
+// каталогов не перезаписывали друг друга.
+// Скорость обработки печатается в stderr.
+
+static const char* USAGE =
+    "usage: batch [--threads N] [--format jsonl|csv] [--output FILE] [--annotate DIR]\n"
+    "             [--list FILE] [INPUT...]\n"
+    "INPUT is a directory, a glob pattern (e.g. 'images/*.jpg') or an image file\n";
+
+// Через сколько изображений печатается промежуточная скорость
+static const int PROGRESS_STEP = 100;
+
+enum class Format
+{
+    JsonLines,
+    Csv
+};
+
+struct Options
+{
+    int threads = 0;
+    Format format = Format::JsonLines;
+    std::string output;
+    std::string annotate;
+    std::vector<std::string> lists;
+    std::vector<std::string> inputs;
+};
+
+// Состояние обработки файла
+enum class Status
+{
+    Ok,
+    // Файл не удалось прочитать как изображение
+    Unreadable,
+    // Исключение при обработке, текст - в Record::error
+    Failed
+};
+
+// Результат обработки одного файла
+struct Record
+{
+    std::string file;
+    Status status = Status::Unreadable;
+    std::string error;
+    int width = 0;
+    int height = 0;
+    double decodeMs = 0.0;
+    double detectMs = 0.0;
+    std::vector<cv::Rect> boxes;
+};
+
+static bool isImageFile(const fs::path& path)
+{
+    static const char* extensions[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp", ".pgm", ".ppm"};
+
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    for (const char* known : extensions)
+    {
+        if (ext == known)
+            return true;
+    }
+    return false;
+}
+
+// Файлы каталога (без подкаталогов), для которых match возвращает true,
+// в порядке имён. Ошибка чтения каталога печатается в stderr, результат - false
+template <typename Match>
+static bool collectMatching(const fs::path& dir, const Match& match, std::vector<std::string>& files)
+{
+    std::vector<std::string> found;
+    std::error_code error;
+
+    fs::directory_iterator it(dir, error);
+    for (; !error && it != fs::directory_iterator(); it.increment(error))
+    {
+        std::error_code fileError;
+        if (it->is_regular_file(fileError) && match(it->path()))
+            found.push_back(it->path().string());
+    }
+
+    if (error)
+    {
+        std::cerr << "batch: cannot read directory " << dir.string() << ": " << error.message() << "\n";
+        return false;
+    }
+
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+    return true;
+}
+
+// Файлы изображений каталога
+static bool collectDirectory(const fs::path& dir, std::vector<std::string>& files)
+{
+    return collectMatching(dir, isImageFile, files);
+}
+
+// Шаблон применяется к именам файлов каталога, указанного в нём
+static bool collectGlob(const std::string& pattern, std::vector<std::string>& files)
+{
+    fs::path path(pattern);
+    fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::string name = path.filename().string();
+
+    return collectMatching(dir, [&](const fs::path& file)
+    {
+        return fnmatch(name.c_str(), file.filename().c_str(), 0) == 0;
+    }, files);
+}
+
+// Пустые строки и строки, начинающиеся с '#', пропускаются
+static bool collectList(const std::string& listFile, std::vector<std::string>& files)
+{
+    std::ifstream file;
+    std::istream* in = &std::cin;
+
+    if (listFile != "-")
+    {
+        file.open(listFile);
+        if (!file)
+            return false;
+        in = &file;
+    }
+
+    std::string line;
+    while (std::getline(*in, line))
+    {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+
+        if (!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return true;
+}
+
+// Ошибки печатаются в stderr, результат - false
+static bool collectInput(const std::string& input, std::vector<std::string>& files)
+{
+    std::error_code error;
+
+    if (fs::is_directory(input, error))
+        return collectDirectory(input, files);
+    if (input.find_first_of("*?[") != std::string::npos)
+        return collectGlob(input, files);
+    if (fs::is_regular_file(input, error))
+    {
+        files.push_back(input);
+        return true;
+    }
+
+    std::cerr << "batch: no such file or directory: " << input << "\n";
+    return false;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue)
+            options.threads = std::atoi(argv[++i]);
+        else if (arg == "--format" && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format == "jsonl")
+                options.format = Format::JsonLines;
+            else if (format == "csv")
+                options.format = Format::Csv;
+            else
+                return false;
+        }
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--annotate" && hasValue)
+            options.annotate = argv[++i];
+        else if (arg == "--list" && hasValue)
+            options.lists.push_back(argv[++i]);
+        else if (arg.size() > 1 && arg[0] == '-' && arg != "-")
+            return false;
+        else
+            options.inputs.push_back(arg);
+    }
+
+    return options.threads >= 0 && !(options.inputs.empty() && options.lists.empty());
+}
+
+static const char* statusName(Status status)
+{
+    switch (status)
+    {
+    case Status::Ok: return "ok";
+    case Status::Unreadable: return "unreadable";
+    case Status::Failed: return "failed";
+    }
+    return "";
+}
+
+static std::string jsonString(const std::string& text)
+{
+    std::string result = "\"";
+
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        }
+        else
+            result += c;
+    }
+
+    return result + "\"";
+}
+
+static std::string csvString(const std::string& text)
+{
+    std::string result = "\"";
+
+    for (char c : text)
+    {
+        if (c == '"')
+            result += '"';
+        result += c;
+    }
+
+    return result + "\"";
+}
+
+// JSON Lines: одна запись на файл, прямоугольники - массив объектов
+static void writeJson(std::ostream& out, const Record& record)
+{
+    out << "{\"file\":" << jsonString(record.file)
+        << ",\"status\":\"" << statusName(record.status) << "\""
+        << ",\"width\":" << record.width << ",\"height\":" << record.height
+        << ",\"decode_ms\":" << record.decodeMs << ",\"detect_ms\":" << record.detectMs
+        << ",\"boxes\":[";
+
+    for (std::size_t i = 0; i < record.boxes.size(); i++)
+    {
+        const cv::Rect& box = record.boxes[i];
+        out << (i ? "," : "") << "{\"x\":" << box.x << ",\"y\":" << box.y
+            << ",\"width\":" << box.width << ",\"height\":" << box.height << "}";
+    }
+
+    out << "]";
+
+    if (record.status == Status::Failed)
+        out << ",\"error\":" << jsonString(record.error);
+
+    out << "}\n";
+}
+
+// CSV: строка на прямоугольник; файл без прямоугольников даёт одну строку
+// с пустыми координатами, чтобы каждый файл присутствовал в результате
+static void writeCsv(std::ostream& out, const Record& record)
+{
+    std::ostringstream prefix;
+    prefix << csvString(record.file) << "," << statusName(record.status) << ","
+        << record.width << "," << record.height << "," << record.decodeMs << "," << record.detectMs << ",";
+
+    if (record.boxes.empty())
+        out << prefix.str() << ",,,\n";
+
+    for (const cv::Rect& box : record.boxes)
+        out << prefix.str() << box.x << "," << box.y << "," << box.width << "," << box.height << "\n";
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Путь разметки вида DIR/000042_name.jpg, номер дополняется нулями до
+// числа цифр в количестве файлов
+static fs::path annotationPath(const std::string& annotateDir, const std::string& file, int index, int total)
+{
+    int digits = std::to_string(std::max(total - 1, 0)).size();
+
+    std::ostringstream name;
+    name << std::setw(digits) << std::setfill('0') << index << "_" << fs::path(file).filename().string();
+
+    return fs::path(annotateDir) / name.str();
+}
+
+// Обработка одного файла детектором текущего потока
+static void detectFile(Record& record, const std::string& annotateDir, int index, int total)
+{
+    const std::string& file = record.file;
+    thread_local RegionDetector detector;
+
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat image = cv::imread(file, cv::IMREAD_GRAYSCALE);
+    record.decodeMs = elapsedMs(start);
+
+    if (image.empty())
+        return;
+
+    record.status = Status::Ok;
+    record.width = image.cols;
+    record.height = image.rows;
+
+    start = std::chrono::steady_clock::now();
+    detector.Detect(image, record.boxes);
+    record.detectMs = elapsedMs(start);
+
+    // Для разметки изображение читается ещё раз в цвете, поэтому
+    // прямоугольники не зависят от того, включена ли разметка
+    if (!annotateDir.empty())
+    {
+        cv::Mat color = cv::imread(file);
+        if (color.empty())
+            return;
+
+        for (const cv::Rect& box : record.boxes)
+            drawRectangle(color, box.x, box.y, box.x + box.width - 1, box.y + box.height - 1);
+
+        fs::path path = annotationPath(annotateDir, file, index, total);
+        std::error_code error;
+        fs::create_directories(path.parent_path(), error);
+        cv::imwrite(path.string(), color);
+    }
+}
+
+// Исключение при обработке одного файла (ошибка OpenCV, нехватка памяти)
+// не прерывает пакет: файл получает состояние failed
+static Record processFile(const std::string& file, const std::string& annotateDir, int index, int total)
+{
+    Record record;
+    record.file = file;
+
+    try
+    {
+        detectFile(record, annotateDir, index, total);
+    }
+    catch (const std::exception& error)
+    {
+        record.status = Status::Failed;
+        record.error = error.what();
+        record.boxes.clear();
+    }
+
+    return record;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << USAGE;
+        return 2;
+    }
+
+    // Собираем список файлов
+    std::vector<std::string> files;
+    bool missing = false;
+    for (const std::string& list : options.lists)
+    {
+        if (!collectList(list, files))
+        {
+            std::cerr << "batch: cannot read list " << list << "\n";
+            return 1;
+        }
+    }
+    for (const std::string& input : options.inputs)
+    {
+        if (!collectInput(input, files))
+            missing = true;
+    }
+
+    std::ofstream outputFile;
+    std::ostream* out = &std::cout;
+    if (!options.output.empty())
+    {
+        outputFile.open(options.output);
+        if (!outputFile)
+        {
+            std::cerr << "batch: cannot open " << options.output << "\n";
+            return 1;
+        }
+        out = &outputFile;
+    }
+
+    if (options.threads > 0)
+        ThreadPool::SetNumThreads(options.threads);
+
+    if (options.format == Format::Csv)
+        *out << "file,status,image_width,image_height,decode_ms,detect_ms,x,y,width,height\n";
+
+    // Каждый поток пула берёт следующий необработанный файл из общего счётчика,
+    // поэтому медленные изображения не задерживают остальные потоки. Внутри
+    // одного изображения обработка идёт последовательно (вложенные вызовы
+    // пула выполняются на месте)
+    std::mutex outputMutex;
+    std::atomic<int> next(0);
+    std::atomic<int> processed(0);
+    std::atomic<int> failed(0);
+    std::atomic<long long> boxCount(0);
+    int total = files.size();
+    auto start = std::chrono::steady_clock::now();
+
+    ThreadPool::ParallelFor(0, ThreadPool::GetNumThreads(), [&](int, int)
+    {
+        for (int i = next++; i < total; i = next++)
+        {
+            Record record = processFile(files[i], options.annotate, i, total);
+
+            if (record.status != Status::Ok)
+                failed++;
+            boxCount += record.boxes.size();
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (options.format == Format::JsonLines)
+                writeJson(*out, record);
+            else
+                writeCsv(*out, record);
+            out->flush();
+
+            int done = ++processed;
+            if (done % PROGRESS_STEP == 0 && done < total)
+            {
+                double seconds = elapsedMs(start) / 1000.0;
+                std::fprintf(stderr, "batch: %d/%d images, %.1f images/s\n", done, total, done / seconds);
+            }
+        }
+    });
+
+    double seconds = elapsedMs(start) / 1000.0;
+    std::fprintf(stderr, "batch: %d images (%d unreadable or failed), %lld boxes, %.2f s, %.1f images/s, %d threads\n",
+        total, failed.load(), boxCount.load(), seconds, seconds > 0 ? total / seconds : 0.0,
+        ThreadPool::GetNumThreads());
+
+    return missing || (failed == total && total > 0) ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Выравнивание начала буфера и каждой строки изображения (размер кэш-линии)
+constexpr std::size_t IMAGE_ALIGNMENT = 64;
+
+// Невладеющее представление изображения: указатель на первую строку,
+// размеры и расстояние между строками в элементах.
+// Позволяет без копирования работать с чужими буферами (например, cv::Mat).
+template <typename T>
+class ImageView
+{
+private:
+    T* data_ = nullptr;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::size_t stride_ = 0;
+
+public:
+    ImageView() {}
+
+    ImageView(T* data, int rows, int cols, std::size_t stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+
+    // Неявное преобразование ImageView<T> -> ImageView<const T>
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    ImageView(const ImageView<U>& other)
+        : data_(other.data()), rows_(other.rows()), cols_(other.cols()), stride_(other.stride()) {}
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::size_t stride() const { return stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    T* data() const { return data_; }
+    T* row(int i) const { return data_ + i * stride_; }
+    T* operator[](int i) const { return row(i); }
+};
+
+// Невладеющий непрерывный диапазон из size элементов, начиная с data.
+// Из вектора строится неявно, поэтому функции, принимающие Span, работают
+// и с векторами, и с частями общих массивов
+template <typename T>
+class Span
+{
+private:
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    Span() {}
+
+    Span(T* data, std::size_t size)
+        : data_(data), size_(size) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_same<U, T>::value || std::is_same<const U, T>::value>::type>
+    Span(std::vector<U>& vec)
+        : data_(vec.data()), size_(vec.size()) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    Span(const std::vector<U>& vec)
+        : data_(vec.data()), size_(vec.size()) {}
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T* data() const { return data_; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    T& operator[](std::size_t i) const { return data_[i]; }
+};
+
+// Непрерывное изображение с выровненными строками.
+// Все строки лежат в одном блоке памяти, расстояние между началами
+// соседних строк (stride) задаётся в элементах и кратно 64 байтам.
+template <typename T>
+class Image
+{
+private:
+    struct AlignedDeleter
+    {
+        void operator()(T* ptr) const { std::free(ptr); }
+    };
+
+    std::unique_ptr<T, AlignedDeleter> data_;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::size_t stride_ = 0;
+
+    static std::size_t AlignedStride(int cols)
+    {
+        std::size_t bytes = static_cast<std::size_t>(cols) * sizeof(T);
+        bytes = (bytes + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+        return bytes / sizeof(T);
+    }
+
+public:
+    Image() {}
+
+    Image(int rows, int cols)
+    {
+        create(rows, cols);
+    }
+
+    Image(int rows, int cols, T value)
+    {
+        create(rows, cols);
+        fill(value);
+    }
+
+    Image(const Image& other)
+    {
+        *this = other;
+    }
+
+    Image(Image&& other) noexcept = default;
+    Image& operator=(Image&& other) noexcept = default;
+
+    Image& operator=(const Image& other)
+    {
+        if (this != &other)
+        {
+            create(other.rows_, other.cols_);
+            for (int i = 0; i < rows_; i++)
+                std::memcpy(row(i), other.row(i), cols_ * sizeof(T));
+        }
+        return *this;
+    }
+
+    // Выделяет память под изображение rows x cols, заполненное нулями.
+    // Если размеры совпадают с текущими, память переиспользуется без очистки.
+    void create(int rows, int cols)
+    {
+        if (data_ && rows == rows_ && cols == cols_)
+            return;
+
+        std::size_t stride = AlignedStride(cols);
+        std::size_t bytes = static_cast<std::size_t>(rows) * stride * sizeof(T);
+        T* ptr = nullptr;
+
+        if (bytes > 0)
+        {
+            ptr = static_cast<T*>(std::aligned_alloc(IMAGE_ALIGNMENT, bytes));
+            if (!ptr)
+                throw std::bad_alloc();
+            std::memset(ptr, 0, bytes);
+        }
+
+        data_.reset(ptr);
+        rows_ = rows;
+        cols_ = cols;
+        stride_ = stride;
+    }
+
+    void fill(T value)
+    {
+        for (int i = 0; i < rows_; i++)
+        {
+            T* r = row(i);
+            for (int j = 0; j < cols_; j++)
+                r[j] = value;
+        }
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::size_t stride() const { return stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    T* data() { return data_.get(); }
+    const T* data() const { return data_.get(); }
+
+    T* row(int i) { return data_.get() + i * stride_; }
+    const T* row(int i) const { return data_.get() + i * stride_; }
+
+    // Доступ вида image[i][j], как у вложенных векторов
+    T* operator[](int i) { return row(i); }
+    const T* operator[](int i) const { return row(i); }
+
+    ImageView<T> view() { return ImageView<T>(data(), rows_, cols_, stride_); }
+    ImageView<const T> view() const { return ImageView<const T>(data(), rows_, cols_, stride_); }
+
+    operator ImageView<T>() { return view(); }
+    operator ImageView<const T>() const { return view(); }
+};
+
+// Бинарное изображение, упакованное по биту на пиксель: пиксель (i, j) - бит j % 64
+// слова j / 64 строки i. Биты за правой границей в последнем слове строки
+// равны нулю, поэтому строки можно просматривать целыми словами.
+class BitMask
+{
+private:
+    Image<uint64_t> words_;
+    int cols_ = 0;
+
+public:
+    BitMask() {}
+
+    BitMask(int rows, int cols)
+    {
+        create(rows, cols);
+    }
+
+    // Память переиспользуется, если размеры совпадают с текущими
+    void create(int rows, int cols)
+    {
+        words_.create(rows, (cols + 63) / 64);
+        cols_ = cols;
+    }
+
+    int rows() const { return words_.rows(); }
+    int cols() const { return cols_; }
+    int wordsPerRow() const { return words_.cols(); }
+    bool empty() const { return rows() == 0 || cols_ == 0; }
+
+    uint64_t* row(int i) { return words_.row(i); }
+    const uint64_t* row(int i) const { return words_.row(i); }
+
+    bool get(int i, int j) const
+    {
+        return (row(i)[j >> 6] >> (j & 63)) & 1;
+    }
+
+    void set(int i, int j, bool value)
+    {
+        uint64_t bit = uint64_t(1) << (j & 63);
+        uint64_t& word = row(i)[j >> 6];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    // Распаковывает маску в изображение 0 / 255 того же размера
+    void toBytes(ImageView<unsigned char> image) const
+    {
+        for (int i = 0; i < rows(); i++)
+        {
+            unsigned char* out = image[i];
+            for (int j = 0; j < cols_; j++)
+                out[j] = get(i, j) ? 255 : 0;
+        }
+    }
+};
+
+// Копирует вложенные векторы в непрерывное изображение
+template <typename T>
+Image<T> toImage(const std::vector<std::vector<T>>& vec)
+{
+    int rows = vec.size();
+    int cols = rows > 0 ? vec[0].size() : 0;
+    Image<T> image(rows, cols);
+
+    for (int i = 0; i < rows; i++)
+        std::memcpy(image.row(i), vec[i].data(), cols * sizeof(T));
+
+    return image;
+}
+
+// Копирует изображение обратно во вложенные векторы того же размера
+template <typename T>
+void toVector(const Image<T>& image, std::vector<std::vector<T>>& vec)
+{
+    vec.resize(image.rows());
+    for (int i = 0; i < image.rows(); i++)
+    {
+        vec[i].resize(image.cols());
+        std::memcpy(vec[i].data(), image.row(i), image.cols() * sizeof(T));
+    }
+}
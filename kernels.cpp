@@ -0,0 +1,117 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "kernels.hpp"
+#include "kernels_int.hpp"
+
+// Скалярные реализации служат эталоном и запасным вариантом
+
+// При K > 0 число коэффициентов известно при компиляции и цикл по ним разворачивается
+template <int K>
+static void BlurRowScalar(const float* src, float* dst, int count, const float* kernel, int kernelSize)
+{
+    const int size = K > 0 ? K : kernelSize;
+
+    for (int j = 0; j < count; j++)
+    {
+        float sum = 0.0f;
+
+        for (int t = 0; t < size; t++)
+            sum += kernel[t] * src[j + t];
+
+        dst[j] = sum;
+    }
+}
+
+template <int K>
+static void BlurColumnScalar(const float* const* rows, const float* weights, int rowCount, float* dst, int count)
+{
+    const int size = K > 0 ? K : rowCount;
+
+    for (int j = 0; j < count; j++)
+        dst[j] = 0.0f;
+
+    for (int k = 0; k < size; k++)
+    {
+        const float* src = rows[k];
+        float w = weights[k];
+
+        for (int j = 0; j < count; j++)
+            dst[j] += w * src[j];
+    }
+}
+
+static void SobelRowScalar(const float* r0, const float* r1, const float* r2, float* dst,
+    float* dstX, float* dstY, int count)
+{
+    for (int j = 0; j < count; j++)
+    {
+        float gradX = (r0[j - 1] - r0[j + 1]) + 2 * (r1[j - 1] - r1[j + 1]) + (r2[j - 1] - r2[j + 1]);
+        float gradY = (r2[j - 1] + 2 * r2[j] + r2[j + 1]) - (r0[j - 1] + 2 * r0[j] + r0[j + 1]);
+
+        dst[j] = std::sqrt(gradX * gradX + gradY * gradY);
+        if (dstX)
+            dstX[j] = gradX;
+        if (dstY)
+            dstY[j] = gradY;
+    }
+}
+
+static void ThresholdRowBitsScalar(const unsigned char* src, uint64_t* dst, int count, int threshold)
+{
+    PackThresholdBits(src, dst, 0, count, threshold);
+}
+
+const ConvolutionKernels& scalarKernels()
+{
+    static const ConvolutionKernels kernels = {
+        "scalar", BlurRowScalar<0>, BlurColumnScalar<0>,
+        {BlurRowScalar<3>, BlurRowScalar<5>, BlurRowScalar<7>, BlurRowScalar<9>},
+        {BlurColumnScalar<3>, BlurColumnScalar<5>, BlurColumnScalar<7>, BlurColumnScalar<9>},
+        BlurRowU8, BlurColumnU8, BlurColumnS16,
+        SobelColumnU8, SobelColumnS16, SobelRowS16,
+        SobelRowScalar,
+        ThresholdRowBitsScalar
+    };
+    return kernels;
+}
+
+// Функция для выбора лучшего набора функций, поддерживаемого процессором
+static const ConvolutionKernels& SelectKernels()
+{
+    // Максимальный допустимый уровень: 0 - scalar, 1 - sse42, 2 - avx2, 3 - avx512
+    int maxLevel = 3;
+    const char* forced = std::getenv("IMG_SIMD");
+
+    if (forced)
+    {
+        const char* names[] = {"scalar", "sse42", "avx2", "avx512"};
+        for (int level = 0; level < 4; level++)
+        {
+            if (std::strcmp(forced, names[level]) == 0)
+                maxLevel = level;
+        }
+    }
+
+#ifdef IMG_X86_KERNELS
+    __builtin_cpu_init();
+
+    if (maxLevel >= 3 && __builtin_cpu_supports("avx512f"))
+        return avx512Kernels();
+    if (maxLevel >= 2 && __builtin_cpu_supports("avx2"))
+        return avx2Kernels();
+    if (maxLevel >= 1 && __builtin_cpu_supports("sse4.2"))
+        return sse42Kernels();
+#else
+    (void)maxLevel;
+#endif
+
+    return scalarKernels();
+}
+
+const ConvolutionKernels& convolutionKernels()
+{
+    static const ConvolutionKernels& kernels = SelectKernels();
+    return kernels;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+// Таблица функций, обрабатывающих внутренние области свёрток.
+// Для каждого набора инструкций процессора существует своя реализация;
+// подходящая выбирается один раз при первом обращении по результатам CPUID.
+// Все реализации выполняют операции в одном и том же порядке и без FMA,
+// поэтому результаты побитово совпадают со скалярной версией.
+
+// dst[j] = sum(kernel[t] * src[j + t]), j = 0..count-1, t = 0..kernelSize-1
+typedef void (*BlurRowFunc)(const float* src, float* dst, int count, const float* kernel, int kernelSize);
+
+// dst[j] = sum(weights[k] * rows[k][j]), j = 0..count-1, k = 0..rowCount-1
+typedef void (*BlurColumnFunc)(const float* const* rows, const float* weights, int rowCount, float* dst, int count);
+
+// Целочисленное размытие: строка uint8 с коэффициентами Q8 (сумма 256) -> uint16
+typedef void (*BlurRowU8Func)(const unsigned char* src, unsigned short* dst, int count,
+    const unsigned short* kernel, int kernelSize);
+
+// Целочисленное размытие по столбцам: строки uint16 (Q8) с коэффициентами Q16 -> uint8 или int16
+// с округлением; acc - рабочий буфер на count элементов
+typedef void (*BlurColumnU8Func)(const unsigned short* const* rows, const unsigned int* weights, int rowCount,
+    unsigned int* acc, unsigned char* dst, int count);
+typedef void (*BlurColumnS16Func)(const unsigned short* const* rows, const unsigned int* weights, int rowCount,
+    unsigned int* acc, short* dst, int count);
+
+// Вертикальный проход целочисленного оператора Собеля 3x3:
+// smooth = r0 + 2 * r1 + r2, deriv = r2 - r0
+typedef void (*SobelColumnU8Func)(const unsigned char* r0, const unsigned char* r1, const unsigned char* r2,
+    short* smooth, short* deriv, int count);
+typedef void (*SobelColumnS16Func)(const short* r0, const short* r1, const short* r2,
+    short* smooth, short* deriv, int count);
+
+// Горизонтальный проход: gradX[j] = smooth[j] - smooth[j + 2],
+// gradY[j] = deriv[j] + 2 * deriv[j + 1] + deriv[j + 2]
+typedef void (*SobelRowS16Func)(const short* smooth, const short* deriv, short* gradX, short* gradY, int count);
+
+// Пороговая бинаризация строки с упаковкой по биту на пиксель (формат BitMask):
+// бит равен 1, если src[j] >= threshold (0..255); записывается (count + 63) / 64 слов
+typedef void (*ThresholdRowBitsFunc)(const unsigned char* src, uint64_t* dst, int count, int threshold);
+
+// Число размеров ядра (3, 5, 7, 9), для которых есть варианты с развёрнутыми циклами
+constexpr int FIXED_KERNEL_COUNT = 4;
+
+// Индекс варианта с фиксированным размером ядра или -1, если такого варианта нет
+constexpr int fixedKernelIndex(int kernelSize)
+{
+    return kernelSize >= 3 && kernelSize <= 9 && kernelSize % 2 == 1 ? (kernelSize - 3) / 2 : -1;
+}
+
+struct ConvolutionKernels
+{
+    const char* name;
+
+    BlurRowFunc blurRow;
+    BlurColumnFunc blurColumn;
+
+    // Варианты для ядер фиксированного размера; kernelSize и rowCount
+    // должны совпадать с размером варианта и не используются
+    BlurRowFunc blurRowFixed[FIXED_KERNEL_COUNT];
+    BlurColumnFunc blurColumnFixed[FIXED_KERNEL_COUNT];
+
+    BlurRowU8Func blurRowU8;
+    BlurColumnU8Func blurColumnU8;
+    BlurColumnS16Func blurColumnS16;
+
+    SobelColumnU8Func sobelColumnU8;
+    SobelColumnS16Func sobelColumnS16;
+    SobelRowS16Func sobelRowS16;
+
+    // Модуль градиента Собеля для пикселей r1[0..count-1]; читаются r*[-1..count].
+    // Если dstX и dstY не равны nullptr, в них записываются компоненты градиента
+    void (*sobelRow)(const float* r0, const float* r1, const float* r2, float* dst,
+        float* dstX, float* dstY, int count);
+
+    ThresholdRowBitsFunc thresholdRowBits;
+};
+
+// Набор функций, выбранный для текущего процессора.
+// Переменная окружения IMG_SIMD (scalar, sse42, avx2, avx512) позволяет
+// принудительно выбрать более простой набор.
+const ConvolutionKernels& convolutionKernels();
+
+const ConvolutionKernels& scalarKernels();
+
+#ifdef IMG_X86_KERNELS
+const ConvolutionKernels& sse42Kernels();
+const ConvolutionKernels& avx2Kernels();
+const ConvolutionKernels& avx512Kernels();
+#endif
@@ -0,0 +1,136 @@
+#include <cmath>
+#include <immintrin.h>
+
+#include "kernels.hpp"
+#include "kernels_int.hpp"
+
+// Реализация для AVX2: 8 пикселей за инструкцию
+
+namespace
+{
+
+// При K > 0 число коэффициентов известно при компиляции и цикл по ним разворачивается
+template <int K>
+void BlurRow(const float* src, float* dst, int count, const float* kernel, int kernelSize)
+{
+    const int size = K > 0 ? K : kernelSize;
+    int j = 0;
+
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+
+        for (int t = 0; t < size; t++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel[t]), _mm256_loadu_ps(src + j + t)));
+
+        _mm256_storeu_ps(dst + j, sum);
+    }
+
+    for (; j < count; j++)
+    {
+        float sum = 0.0f;
+
+        for (int t = 0; t < size; t++)
+            sum += kernel[t] * src[j + t];
+
+        dst[j] = sum;
+    }
+}
+
+template <int K>
+void BlurColumn(const float* const* rows, const float* weights, int rowCount, float* dst, int count)
+{
+    const int size = K > 0 ? K : rowCount;
+    int j = 0;
+
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+
+        for (int k = 0; k < size; k++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + j)));
+
+        _mm256_storeu_ps(dst + j, sum);
+    }
+
+    for (; j < count; j++)
+    {
+        float sum = 0.0f;
+
+        for (int k = 0; k < size; k++)
+            sum += weights[k] * rows[k][j];
+
+        dst[j] = sum;
+    }
+}
+
+void SobelRow(const float* r0, const float* r1, const float* r2, float* dst,
+    float* dstX, float* dstY, int count)
+{
+    const __m256 two = _mm256_set1_ps(2.0f);
+    int j = 0;
+
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 a0 = _mm256_loadu_ps(r0 + j - 1), b0 = _mm256_loadu_ps(r0 + j), c0 = _mm256_loadu_ps(r0 + j + 1);
+        __m256 a1 = _mm256_loadu_ps(r1 + j - 1), c1 = _mm256_loadu_ps(r1 + j + 1);
+        __m256 a2 = _mm256_loadu_ps(r2 + j - 1), b2 = _mm256_loadu_ps(r2 + j), c2 = _mm256_loadu_ps(r2 + j + 1);
+
+        __m256 gradX = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(a0, c0), _mm256_mul_ps(two, _mm256_sub_ps(a1, c1))), _mm256_sub_ps(a2, c2));
+        __m256 gradY = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(a2, _mm256_mul_ps(two, b2)), c2),
+                                  _mm256_add_ps(_mm256_add_ps(a0, _mm256_mul_ps(two, b0)), c0));
+
+        _mm256_storeu_ps(dst + j, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(gradX, gradX), _mm256_mul_ps(gradY, gradY))));
+        if (dstX)
+            _mm256_storeu_ps(dstX + j, gradX);
+        if (dstY)
+            _mm256_storeu_ps(dstY + j, gradY);
+    }
+
+    for (; j < count; j++)
+    {
+        float gradX = (r0[j - 1] - r0[j + 1]) + 2 * (r1[j - 1] - r1[j + 1]) + (r2[j - 1] - r2[j + 1]);
+        float gradY = (r2[j - 1] + 2 * r2[j] + r2[j + 1]) - (r0[j - 1] + 2 * r0[j] + r0[j + 1]);
+
+        dst[j] = std::sqrt(gradX * gradX + gradY * gradY);
+        if (dstX)
+            dstX[j] = gradX;
+        if (dstY)
+            dstY[j] = gradY;
+    }
+}
+
+void ThresholdRowBits(const unsigned char* src, uint64_t* dst, int count, int threshold)
+{
+    // src >= threshold <=> max(src, threshold) == src (беззнаковое сравнение байтов)
+    const __m256i t = _mm256_set1_epi8(static_cast<char>(threshold));
+    int j = 0;
+
+    for (; j + 64 <= count; j += 64)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j + 32));
+        uint64_t bitsLo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, t), lo)));
+        uint64_t bitsHi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(hi, t), hi)));
+
+        dst[j / 64] = bitsLo | (bitsHi << 32);
+    }
+
+    PackThresholdBits(src, dst, j, count, threshold);
+}
+
+}
+
+const ConvolutionKernels& avx2Kernels()
+{
+    static const ConvolutionKernels kernels = {
+        "avx2", BlurRow<0>, BlurColumn<0>,
+        {BlurRow<3>, BlurRow<5>, BlurRow<7>, BlurRow<9>},
+        {BlurColumn<3>, BlurColumn<5>, BlurColumn<7>, BlurColumn<9>},
+        BlurRowU8, BlurColumnU8, BlurColumnS16,
+        SobelColumnU8, SobelColumnS16, SobelRowS16,
+        SobelRow,
+        ThresholdRowBits
+    };
+    return kernels;
+}
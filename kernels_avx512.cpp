@@ -0,0 +1,112 @@
+#include <immintrin.h>
+
+#include "kernels.hpp"
+#include "kernels_int.hpp"
+
+// Реализация для AVX-512: 16 пикселей за инструкцию.
+// Остаток строки обрабатывается той же векторной веткой с маской.
+
+namespace
+{
+
+inline __mmask16 TailMask(int remaining)
+{
+    return remaining >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << remaining) - 1);
+}
+
+// При K > 0 число коэффициентов известно при компиляции и цикл по ним разворачивается
+template <int K>
+void BlurRow(const float* src, float* dst, int count, const float* kernel, int kernelSize)
+{
+    const int size = K > 0 ? K : kernelSize;
+
+    for (int j = 0; j < count; j += 16)
+    {
+        __mmask16 mask = TailMask(count - j);
+        __m512 sum = _mm512_setzero_ps();
+
+        for (int t = 0; t < size; t++)
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(kernel[t]), _mm512_maskz_loadu_ps(mask, src + j + t)));
+
+        _mm512_mask_storeu_ps(dst + j, mask, sum);
+    }
+}
+
+template <int K>
+void BlurColumn(const float* const* rows, const float* weights, int rowCount, float* dst, int count)
+{
+    const int size = K > 0 ? K : rowCount;
+
+    for (int j = 0; j < count; j += 16)
+    {
+        __mmask16 mask = TailMask(count - j);
+        __m512 sum = _mm512_setzero_ps();
+
+        for (int k = 0; k < size; k++)
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(weights[k]), _mm512_maskz_loadu_ps(mask, rows[k] + j)));
+
+        _mm512_mask_storeu_ps(dst + j, mask, sum);
+    }
+}
+
+void SobelRow(const float* r0, const float* r1, const float* r2, float* dst,
+    float* dstX, float* dstY, int count)
+{
+    const __m512 two = _mm512_set1_ps(2.0f);
+
+    for (int j = 0; j < count; j += 16)
+    {
+        __mmask16 mask = TailMask(count - j);
+
+        __m512 a0 = _mm512_maskz_loadu_ps(mask, r0 + j - 1), b0 = _mm512_maskz_loadu_ps(mask, r0 + j), c0 = _mm512_maskz_loadu_ps(mask, r0 + j + 1);
+        __m512 a1 = _mm512_maskz_loadu_ps(mask, r1 + j - 1), c1 = _mm512_maskz_loadu_ps(mask, r1 + j + 1);
+        __m512 a2 = _mm512_maskz_loadu_ps(mask, r2 + j - 1), b2 = _mm512_maskz_loadu_ps(mask, r2 + j), c2 = _mm512_maskz_loadu_ps(mask, r2 + j + 1);
+
+        __m512 gradX = _mm512_add_ps(_mm512_add_ps(_mm512_sub_ps(a0, c0), _mm512_mul_ps(two, _mm512_sub_ps(a1, c1))), _mm512_sub_ps(a2, c2));
+        __m512 gradY = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(a2, _mm512_mul_ps(two, b2)), c2),
+                                     _mm512_add_ps(_mm512_add_ps(a0, _mm512_mul_ps(two, b0)), c0));
+
+        _mm512_mask_storeu_ps(dst + j, mask, _mm512_maskz_sqrt_ps(mask, _mm512_add_ps(_mm512_mul_ps(gradX, gradX), _mm512_mul_ps(gradY, gradY))));
+        if (dstX)
+            _mm512_mask_storeu_ps(dstX + j, mask, gradX);
+        if (dstY)
+            _mm512_mask_storeu_ps(dstY + j, mask, gradY);
+    }
+}
+
+// Сравнение байтов с маской требует AVX-512BW, которого нет в наборе -mavx512f,
+// поэтому бинаризация использует 256-битные команды AVX2
+void ThresholdRowBits(const unsigned char* src, uint64_t* dst, int count, int threshold)
+{
+    // src >= threshold <=> max(src, threshold) == src (беззнаковое сравнение байтов)
+    const __m256i t = _mm256_set1_epi8(static_cast<char>(threshold));
+    int j = 0;
+
+    for (; j + 64 <= count; j += 64)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j + 32));
+        uint64_t bitsLo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, t), lo)));
+        uint64_t bitsHi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(hi, t), hi)));
+
+        dst[j / 64] = bitsLo | (bitsHi << 32);
+    }
+
+    PackThresholdBits(src, dst, j, count, threshold);
+}
+
+}
+
+const ConvolutionKernels& avx512Kernels()
+{
+    static const ConvolutionKernels kernels = {
+        "avx512", BlurRow<0>, BlurColumn<0>,
+        {BlurRow<3>, BlurRow<5>, BlurRow<7>, BlurRow<9>},
+        {BlurColumn<3>, BlurColumn<5>, BlurColumn<7>, BlurColumn<9>},
+        BlurRowU8, BlurColumnU8, BlurColumnS16,
+        SobelColumnU8, SobelColumnS16, SobelRowS16,
+        SobelRow,
+        ThresholdRowBits
+    };
+    return kernels;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+
+// Целочисленные функции размытия для ConvolutionKernels.
+// Файл включается в каждую реализацию таблицы и компилируется с её флагами,
+// поэтому простые циклы ниже векторизуются компилятором под соответствующий
+// набор инструкций (16 - 64 пикселя за инструкцию). Функции находятся в
+// безымянном пространстве имён, чтобы версии из разных единиц трансляции
+// не смешивались при компоновке.
+
+namespace
+{
+
+// dst[j] = sum(kernel[t] * src[j + t]); коэффициенты в формате Q8 (сумма 256),
+// поэтому результат не превышает 255 * 256 и помещается в 16 бит
+void BlurRowU8(const unsigned char* src, unsigned short* dst, int count, const unsigned short* kernel, int kernelSize)
+{
+    for (int j = 0; j < count; j++)
+        dst[j] = 0;
+
+    for (int t = 0; t < kernelSize; t++)
+    {
+        const unsigned char* s = src + t;
+        unsigned short w = kernel[t];
+
+        for (int j = 0; j < count; j++)
+            dst[j] += w * s[j];
+    }
+}
+
+// dst[j] = round(sum(weights[k] * rows[k][j]) / 2^24): строки в формате Q8,
+// коэффициенты в формате Q16 (сумма 65536), сумма накапливается в 32-битном
+// буфере acc. Переполнения нет: 255 * 256 * 65536 + 2^23 < 2^32
+template <typename T>
+void BlurColumnU16(const unsigned short* const* rows, const unsigned int* weights, int rowCount,
+    unsigned int* acc, T* dst, int count)
+{
+    for (int j = 0; j < count; j++)
+        acc[j] = 1u << 23;
+
+    for (int k = 0; k < rowCount; k++)
+    {
+        const unsigned short* src = rows[k];
+        unsigned int w = weights[k];
+
+        for (int j = 0; j < count; j++)
+            acc[j] += w * src[j];
+    }
+
+    for (int j = 0; j < count; j++)
+        dst[j] = static_cast<T>(acc[j] >> 24);
+}
+
+void BlurColumnU8(const unsigned short* const* rows, const unsigned int* weights, int rowCount,
+    unsigned int* acc, unsigned char* dst, int count)
+{
+    BlurColumnU16(rows, weights, rowCount, acc, dst, count);
+}
+
+void BlurColumnS16(const unsigned short* const* rows, const unsigned int* weights, int rowCount,
+    unsigned int* acc, short* dst, int count)
+{
+    BlurColumnU16(rows, weights, rowCount, acc, dst, count);
+}
+
+// Вертикальный проход целочисленного оператора Собеля 3x3:
+// smooth[j] = r0[j] + 2 * r1[j] + r2[j], deriv[j] = r2[j] - r0[j]
+template <typename T>
+void SobelColumn(const T* r0, const T* r1, const T* r2, short* smooth, short* deriv, int count)
+{
+    for (int j = 0; j < count; j++)
+    {
+        smooth[j] = static_cast<short>(r0[j] + 2 * r1[j] + r2[j]);
+        deriv[j] = static_cast<short>(r2[j] - r0[j]);
+    }
+}
+
+void SobelColumnU8(const unsigned char* r0, const unsigned char* r1, const unsigned char* r2,
+    short* smooth, short* deriv, int count)
+{
+    SobelColumn(r0, r1, r2, smooth, deriv, count);
+}
+
+void SobelColumnS16(const short* r0, const short* r1, const short* r2, short* smooth, short* deriv, int count)
+{
+    SobelColumn(r0, r1, r2, smooth, deriv, count);
+}
+
+// Горизонтальный проход: gradX[j] = smooth[j] - smooth[j + 2],
+// gradY[j] = deriv[j] + 2 * deriv[j + 1] + deriv[j + 2]
+void SobelRowS16(const short* smooth, const short* deriv, short* gradX, short* gradY, int count)
+{
+    for (int j = 0; j < count; j++)
+    {
+        gradX[j] = static_cast<short>(smooth[j] - smooth[j + 2]);
+        gradY[j] = static_cast<short>(deriv[j] + 2 * deriv[j + 1] + deriv[j + 2]);
+    }
+}
+
+// Упаковка пикселей src[begin..count-1] в биты dst (begin кратно 64):
+// бит равен 1, если пиксель не меньше threshold (0..255). Биты последнего
+// слова за пределами count обнуляются
+void PackThresholdBits(const unsigned char* src, uint64_t* dst, int begin, int count, int threshold)
+{
+    for (int j = begin; j < count; j += 64)
+    {
+        int n = count - j < 64 ? count - j : 64;
+        uint64_t word = 0;
+
+        for (int k = 0; k < n; k++)
+            word |= uint64_t(src[j + k] >= threshold) << k;
+
+        dst[j / 64] = word;
+    }
+}
+
+}
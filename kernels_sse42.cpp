@@ -0,0 +1,140 @@
+#include <cmath>
+#include <nmmintrin.h>
+
+#include "kernels.hpp"
+#include "kernels_int.hpp"
+
+// Реализация для SSE4.2: 4 пикселя за инструкцию
+
+namespace
+{
+
+// При K > 0 число коэффициентов известно при компиляции и цикл по ним разворачивается
+template <int K>
+void BlurRow(const float* src, float* dst, int count, const float* kernel, int kernelSize)
+{
+    const int size = K > 0 ? K : kernelSize;
+    int j = 0;
+
+    for (; j + 4 <= count; j += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+
+        for (int t = 0; t < size; t++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel[t]), _mm_loadu_ps(src + j + t)));
+
+        _mm_storeu_ps(dst + j, sum);
+    }
+
+    for (; j < count; j++)
+    {
+        float sum = 0.0f;
+
+        for (int t = 0; t < size; t++)
+            sum += kernel[t] * src[j + t];
+
+        dst[j] = sum;
+    }
+}
+
+template <int K>
+void BlurColumn(const float* const* rows, const float* weights, int rowCount, float* dst, int count)
+{
+    const int size = K > 0 ? K : rowCount;
+    int j = 0;
+
+    for (; j + 4 <= count; j += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+
+        for (int k = 0; k < size; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + j)));
+
+        _mm_storeu_ps(dst + j, sum);
+    }
+
+    for (; j < count; j++)
+    {
+        float sum = 0.0f;
+
+        for (int k = 0; k < size; k++)
+            sum += weights[k] * rows[k][j];
+
+        dst[j] = sum;
+    }
+}
+
+void SobelRow(const float* r0, const float* r1, const float* r2, float* dst,
+    float* dstX, float* dstY, int count)
+{
+    const __m128 two = _mm_set1_ps(2.0f);
+    int j = 0;
+
+    for (; j + 4 <= count; j += 4)
+    {
+        __m128 a0 = _mm_loadu_ps(r0 + j - 1), b0 = _mm_loadu_ps(r0 + j), c0 = _mm_loadu_ps(r0 + j + 1);
+        __m128 a1 = _mm_loadu_ps(r1 + j - 1), c1 = _mm_loadu_ps(r1 + j + 1);
+        __m128 a2 = _mm_loadu_ps(r2 + j - 1), b2 = _mm_loadu_ps(r2 + j), c2 = _mm_loadu_ps(r2 + j + 1);
+
+        __m128 gradX = _mm_add_ps(_mm_add_ps(_mm_sub_ps(a0, c0), _mm_mul_ps(two, _mm_sub_ps(a1, c1))), _mm_sub_ps(a2, c2));
+        __m128 gradY = _mm_sub_ps(_mm_add_ps(_mm_add_ps(a2, _mm_mul_ps(two, b2)), c2),
+                                  _mm_add_ps(_mm_add_ps(a0, _mm_mul_ps(two, b0)), c0));
+
+        _mm_storeu_ps(dst + j, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gradX, gradX), _mm_mul_ps(gradY, gradY))));
+        if (dstX)
+            _mm_storeu_ps(dstX + j, gradX);
+        if (dstY)
+            _mm_storeu_ps(dstY + j, gradY);
+    }
+
+    for (; j < count; j++)
+    {
+        float gradX = (r0[j - 1] - r0[j + 1]) + 2 * (r1[j - 1] - r1[j + 1]) + (r2[j - 1] - r2[j + 1]);
+        float gradY = (r2[j - 1] + 2 * r2[j] + r2[j + 1]) - (r0[j - 1] + 2 * r0[j] + r0[j + 1]);
+
+        dst[j] = std::sqrt(gradX * gradX + gradY * gradY);
+        if (dstX)
+            dstX[j] = gradX;
+        if (dstY)
+            dstY[j] = gradY;
+    }
+}
+
+void ThresholdRowBits(const unsigned char* src, uint64_t* dst, int count, int threshold)
+{
+    // src >= threshold <=> max(src, threshold) == src (беззнаковое сравнение байтов)
+    const __m128i t = _mm_set1_epi8(static_cast<char>(threshold));
+    int j = 0;
+
+    for (; j + 64 <= count; j += 64)
+    {
+        uint64_t word = 0;
+
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j + 16 * k));
+            uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v)));
+            word |= bits << (16 * k);
+        }
+
+        dst[j / 64] = word;
+    }
+
+    PackThresholdBits(src, dst, j, count, threshold);
+}
+
+}
+
+const ConvolutionKernels& sse42Kernels()
+{
+    static const ConvolutionKernels kernels = {
+        "sse42", BlurRow<0>, BlurColumn<0>,
+        {BlurRow<3>, BlurRow<5>, BlurRow<7>, BlurRow<9>},
+        {BlurColumn<3>, BlurColumn<5>, BlurColumn<7>, BlurColumn<9>},
+        BlurRowU8, BlurColumnU8, BlurColumnS16,
+        SobelColumnU8, SobelColumnS16, SobelRowS16,
+        SobelRow,
+        ThresholdRowBits
+    };
+    return kernels;
+}
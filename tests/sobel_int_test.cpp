@@ -0,0 +1,117 @@
+#include <cmath>
+#include <cstdio>
+#include <exception>
+
+#include "utils.hpp"
+
+// Проверка целочисленного оператора Собеля на границе допустимого диапазона
+// входа int16: результат должен совпадать с оператором для float, а выход
+// за диапазон - отклоняться. Табличный модуль градиента должен отличаться
+// от точного не больше чем на 0.1%
+
+static int failures = 0;
+
+static void check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::printf("FAILED: %s\n", message);
+        failures++;
+    }
+}
+
+// Ступеньки от -value к value по вертикали и по горизонтали
+static Image<short> makeSteps(int size, short value)
+{
+    Image<short> image(size, size);
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            image[i][j] = (i < size / 2) == (j < size / 3) ? value : -value;
+    return image;
+}
+
+static void testMatchesFloat(short value)
+{
+    const int size = 12;
+    Image<short> image = makeSteps(size, value);
+
+    Image<float> imageFloat(size, size);
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            imageFloat[i][j] = image[i][j];
+
+    Image<short> gradX(size, size), gradY(size, size);
+    sobelOperator(image.view(), gradX.view(), gradY.view());
+
+    Image<float> magnitude(size, size), expectedX(size, size), expectedY(size, size);
+    sobelOperator(imageFloat.view(), magnitude.view(), expectedX.view(), expectedY.view());
+
+    bool equal = true;
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            equal &= gradX[i][j] == expectedX[i][j] && gradY[i][j] == expectedY[i][j];
+
+    check(equal, "int16 Sobel differs from float Sobel at the range bound");
+}
+
+static void testRejectsOutOfRange(short value)
+{
+    const int size = 12;
+    Image<short> image = makeSteps(size, value);
+    Image<short> gradX(size, size), gradY(size, size);
+
+    bool rejected = false;
+    try
+    {
+        sobelOperator(image.view(), gradX.view(), gradY.view());
+    }
+    catch (const std::exception&)
+    {
+        rejected = true;
+    }
+
+    check(rejected, "int16 Sobel accepted input outside -4095..4095");
+}
+
+// Все пары |gx| = a, |gy| = 0..columns - 1 для a из [firstA, firstA + rows)
+static void testTableMagnitude(int firstA, int rows, int columns)
+{
+    Image<short> gradX(rows, columns), gradY(rows, columns);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < columns; j++)
+        {
+            gradX[i][j] = (i % 2 ? 1 : -1) * (firstA + i);
+            gradY[i][j] = (j % 2 ? 1 : -1) * j;
+        }
+
+    Image<float> magnitude(rows, columns);
+    gradientMagnitude(gradX.view(), gradY.view(), magnitude.view(), GradientMagnitude::Table);
+
+    bool within = true;
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < columns; j++)
+        {
+            double a = firstA + i;
+            double exact = std::sqrt(a * a + static_cast<double>(j) * j);
+            within &= std::fabs(magnitude[i][j] - exact) <= 0.001 * exact;
+        }
+
+    check(within, "table gradient magnitude error exceeds 0.1%");
+}
+
+int main()
+{
+    testMatchesFloat(4095);
+    testMatchesFloat(-4095);
+    testRejectsOutOfRange(4096);
+    testRejectsOutOfRange(8191);
+
+    testTableMagnitude(0, 1025, 1025);
+    // Наибольшая погрешность на диапазоне 8 * 4095 - при a = 11776, |gy| = 11753
+    testTableMagnitude(11776, 1, 11777);
+    testTableMagnitude(32760, 1, 32761);
+
+    if (failures == 0)
+        std::printf("sobel_int_test: OK\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "thread_pool.hpp"
+
+// Проверка передачи исключений из полос ParallelFor вызывающему потоку
+// и работы пула после исключения
+
+static int failures = 0;
+
+static void check(bool condition, const char* message)
+{
+    if (!condition)
+    {
+        std::printf("FAILED: %s\n", message);
+        failures++;
+    }
+}
+
+// Исключение из полосы, содержащей строку row
+static void testRethrows(int row)
+{
+    bool caught = false;
+    try
+    {
+        ThreadPool::ParallelFor(0, 1000, [&](int begin, int end)
+        {
+            if (begin <= row && row < end)
+                throw std::runtime_error("band " + std::to_string(row));
+        });
+    }
+    catch (const std::runtime_error& error)
+    {
+        caught = error.what() == "band " + std::to_string(row);
+    }
+
+    check(caught, "exception from a band was not passed to the caller");
+}
+
+// После исключения пул продолжает делить работу между потоками
+static void testParallelAfterError()
+{
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    ThreadPool::ParallelFor(0, 64, [&](int, int)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+
+    check(threads.size() > 1, "ParallelFor runs serially after an exception");
+}
+
+int main()
+{
+    ThreadPool::SetNumThreads(4);
+
+    testRethrows(0);
+    testRethrows(999);
+    testParallelAfterError();
+
+    // Исключение во всех полосах, в том числе в полосе вызывающего потока
+    for (int i = 0; i < 10; i++)
+    {
+        bool caught = false;
+        try
+        {
+            ThreadPool::ParallelFor(0, 1000, [](int, int) { throw std::runtime_error("all"); });
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        check(caught, "exception from every band was not passed to the caller");
+    }
+    testParallelAfterError();
+
+    if (failures == 0)
+        std::printf("thread_pool_test: OK\n");
+    return failures == 0 ? 0 : 1;
+}
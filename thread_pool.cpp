@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "thread_pool.hpp"
+
+// Признак того, что поток выполняет полосу ParallelFor
+static thread_local bool insideParallel = false;
+
+// Признак insideParallel на время выполнения полос вызывающим потоком
+class ParallelScope
+{
+public:
+    ParallelScope() { insideParallel = true; }
+    ~ParallelScope() { insideParallel = false; }
+};
+
+ThreadPool::ThreadPool()
+    : nextBand_(0)
+{
+    int numThreads = 0;
+    const char* env = std::getenv("IMG_THREADS");
+
+    if (env)
+        numThreads = std::atoi(env);
+
+    Start(numThreads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+ThreadPool& ThreadPool::Instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Start(int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    numThreads_ = numThreads;
+    for (int i = 1; i < numThreads; i++)
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, generation_);
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (std::thread& worker : workers_)
+        worker.join();
+
+    workers_.clear();
+    stop_ = false;
+    numThreads_ = 1;
+}
+
+// seen - номер последнего задания на момент запуска потока
+void ThreadPool::WorkerLoop(unsigned long seen)
+{
+    insideParallel = true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_)
+            return;
+
+        seen = generation_;
+        lock.unlock();
+        RunBands();
+        lock.lock();
+
+        // Задание завершено, когда его покинули все рабочие потоки
+        if (++finished_ == numThreads_ - 1)
+            done_.notify_one();
+    }
+}
+
+// Функция для обработки полос текущего задания: каждый поток забирает
+// следующую свободную полосу, пока они не закончатся. После исключения
+// оставшиеся полосы не раздаются, а исключение сохраняется для Run
+void ThreadPool::RunBands()
+{
+    while (true)
+    {
+        int band = nextBand_.fetch_add(1);
+        if (band >= bandCount_)
+            break;
+
+        int begin = begin_ + band * bandSize_;
+        try
+        {
+            func_(context_, begin, std::min(begin + bandSize_, end_));
+        }
+        catch (...)
+        {
+            nextBand_ = bandCount_;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+    }
+}
+
+void ThreadPool::Run(int begin, int end, int grain, BandFunc func, void* context)
+{
+    int rows = end - begin;
+    if (rows <= 0)
+        return;
+
+    grain = std::max(grain, 1);
+
+    // Вложенный вызов, один поток или слишком мало строк для деления
+    if (insideParallel || numThreads_ == 1 || rows < 2 * grain)
+    {
+        func(context, begin, end);
+        return;
+    }
+
+    // Задания от разных внешних потоков выполняются по очереди
+    std::lock_guard<std::mutex> run(runMutex_);
+
+    // Полос больше, чем потоков, чтобы выровнять нагрузку
+    int bandCount = std::min((rows + grain - 1) / grain, numThreads_ * 4);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        func_ = func;
+        context_ = context;
+        begin_ = begin;
+        end_ = end;
+        bandSize_ = (rows + bandCount - 1) / bandCount;
+        bandCount_ = (rows + bandSize_ - 1) / bandSize_;
+        nextBand_ = 0;
+        finished_ = 0;
+        generation_++;
+    }
+    wake_.notify_all();
+
+    {
+        ParallelScope scope;
+        RunBands();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&] { return finished_ == numThreads_ - 1; });
+
+    if (error_)
+    {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::SetNumThreads(int numThreads)
+{
+    ThreadPool& pool = Instance();
+    std::lock_guard<std::mutex> run(pool.runMutex_);
+
+    pool.Stop();
+    pool.Start(numThreads);
+}
+
+int ThreadPool::GetNumThreads()
+{
+    return Instance().numThreads_;
+}
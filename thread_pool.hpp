@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Общий пул потоков для обработки изображения полосами строк.
+// Вызывающий поток участвует в работе наравне с рабочими, поэтому при
+// N потоках создаётся N - 1 рабочий. Вложенные вызовы ParallelFor
+// (из тела другого ParallelFor) выполняются последовательно в текущем потоке.
+// Число потоков по умолчанию - число ядер процессора, его можно ограничить
+// переменной окружения IMG_THREADS или функцией SetNumThreads.
+// Исключение из полосы прекращает раздачу оставшихся полос; после завершения
+// уже начатых полос первое исключение передаётся вызывающему ParallelFor.
+class ThreadPool
+{
+private:
+    typedef void (*BandFunc)(void* context, int begin, int end);
+
+    std::vector<std::thread> workers_;
+    int numThreads_ = 1;
+
+    // Параметры текущего задания
+    std::mutex runMutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    unsigned long generation_ = 0;
+    int finished_ = 0;
+    bool stop_ = false;
+
+    BandFunc func_ = nullptr;
+    void* context_ = nullptr;
+    int begin_ = 0;
+    int end_ = 0;
+    int bandSize_ = 0;
+    int bandCount_ = 0;
+    std::atomic<int> nextBand_;
+    // Первое исключение текущего задания
+    std::exception_ptr error_;
+
+    ThreadPool();
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& Instance();
+
+    void Start(int numThreads);
+    void Stop();
+    void WorkerLoop(unsigned long seen);
+    void RunBands();
+    void Run(int begin, int end, int grain, BandFunc func, void* context);
+
+    template <typename Body>
+    static void CallBody(void* context, int begin, int end)
+    {
+        (*static_cast<const Body*>(context))(begin, end);
+    }
+
+public:
+    // Задаёт число потоков (0 - по числу ядер). Нельзя вызывать
+    // одновременно с ParallelFor
+    static void SetNumThreads(int numThreads);
+    static int GetNumThreads();
+
+    // Делит диапазон строк [begin, end) на полосы не короче grain строк
+    // и вызывает body(bandBegin, bandEnd) для каждой полосы параллельно.
+    // Возвращает управление после обработки всех полос; исключение из body
+    // передаётся вызывающему потоку.
+    template <typename Body>
+    static void ParallelFor(int begin, int end, const Body& body, int grain = 1)
+    {
+        Instance().Run(begin, end, grain, &CallBody<Body>, const_cast<Body*>(&body));
+    }
+};
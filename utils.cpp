@@ -1,69 +1,133 @@
 #include "utils.hpp"
+#include "kernels.hpp"
+#include "thread_pool.hpp"
 
-std::vector<int> Binarization::ComputeHistogram(const std::vector<std::vector<uchar>>& image)
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Функция для получения рабочего буфера текущего потока на count элементов.
+// Память выделяется при первом обращении и переиспользуется следующими
+// вызовами; Slot различает буферы одного типа, нужные одновременно.
+template <typename T, int Slot = 0>
+static T* ThreadScratch(std::size_t count)
 {
-    std::vector<int> histogram(256, 0);
+    thread_local std::vector<T> buffer;
+
+    if (buffer.size() < count)
+        buffer.resize(count);
+
+    return buffer.data();
+}
+
+// Функция для получения временного изображения текущего потока:
+// строки выровнены так же, как в Image
+template <typename T, int Slot = 0>
+static ImageView<T> ThreadScratchImage(int rows, int cols)
+{
+    std::size_t stride = (cols * sizeof(T) + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT / sizeof(T);
+    return ImageView<T>(ThreadScratch<T, Slot>(rows * stride), rows, cols, stride);
+}
 
-    for (const auto& row: image)
+// Минимальная высота полосы строк при параллельной обработке
+static const int ROW_GRAIN = 16;
+
+void HistogramAccumulator::Reset()
+{
+    std::fill(&bins_[0][0], &bins_[0][0] + BANK_COUNT * 256, 0);
+}
+
+void HistogramAccumulator::AddRow(const uchar* row, int count)
+{
+    int j = 0;
+
+    for (; j + BANK_COUNT <= count; j += BANK_COUNT)
     {
-        for (const auto& pixel: row)
-        {
-            int intensity = static_cast<int>(pixel);
-            histogram[intensity]++;
-        }
+        bins_[0][row[j]]++;
+        bins_[1][row[j + 1]]++;
+        bins_[2][row[j + 2]]++;
+        bins_[3][row[j + 3]]++;
     }
 
-    return histogram;
+    for (; j < count; j++)
+        bins_[0][row[j]]++;
+}
+
+void HistogramAccumulator::AddImage(ImageView<const uchar> image)
+{
+    for (int i = 0; i < image.rows(); i++)
+        AddRow(image[i], image.cols());
 }
 
-std::vector<int> Binarization::ComputeCumulativeSum(const std::vector<int>& input)
+void HistogramAccumulator::AddTo(int* histogram) const
 {
-    std::vector<int> output(input.size());
-    int sum = 0;
+    for (int k = 0; k < 256; k++)
+        histogram[k] += bins_[0][k] + bins_[1][k] + bins_[2][k] + bins_[3][k];
+}
+
+std::vector<int> computeHistogram(ImageView<const uchar> image)
+{
+    std::vector<int> histogram(256, 0);
+    std::mutex mutex;
 
-    for (int i = 0; i < input.size(); i++)
+    ThreadPool::ParallelFor(0, image.rows(), [&](int begin, int end)
     {
-        sum += input[i];
-        output[i] = sum;
-    }
-    
-    return output;
+        HistogramAccumulator accumulator;
+        accumulator.AddImage(ImageView<const uchar>(image[begin], end - begin, image.cols(), image.stride()));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        accumulator.AddTo(histogram.data());
+    }, 64);
+
+    return histogram;
+}
+
+std::vector<int> Binarization::ComputeHistogram(ImageView<const uchar> image)
+{
+    return computeHistogram(image);
 }
 
 float Binarization::ComputeMeanIntensity(const std::vector<int>& histogram)
 {
-    float sum = 0.0f;
-    float count = 0.0f;
+    // Для кадров в десятки мегапикселей i * histogram[i] не помещается в int
+    double sum = 0.0;
+    int64_t count = 0;
 
-    for (int i = 0; i < histogram.size(); i++)
+    for (size_t i = 0; i < histogram.size(); i++)
     {
-        sum += i * histogram[i];
+        sum += static_cast<double>(i) * histogram[i];
         count += histogram[i];
     }
 
     return sum / count;
 }
 
-float Binarization::ComputeOtsuThreshold(const std::vector<std::vector<uchar>>& image)
+float Binarization::ComputeOtsuThreshold(const std::vector<int>& histogram)
 {
-    std::vector<int> histogram = Binarization::ComputeHistogram(image);
-    std::vector<int> cumulativeSum = Binarization::ComputeCumulativeSum(histogram);
+    int64_t size = 0;
+    for (size_t i = 0; i < histogram.size(); i++)
+        size += histogram[i];
 
-    int size = image.size() * image[0].size();
-    float meanIntensity = Binarization::ComputeMeanIntensity(histogram);
+    // Накопленная сумма гистограммы считается по ходу перебора порогов;
+    // суммы и произведения - в int64_t и double, чтобы не переполнялись
+    // на больших кадрах (cumulativeSum * 255 > 2^31 при 8.4 Мп)
+    int64_t cumulativeSum = 0;
+    double meanIntensity = Binarization::ComputeMeanIntensity(histogram);
 
-    float maxVariance = 0.0f;
+    double maxVariance = 0.0;
     float threshold = 0.0f;
 
-    for (int i = 0; i < histogram.size(); i++)
+    for (size_t i = 0; i < histogram.size(); i++)
     {
-        float weightBackground = static_cast<float>(cumulativeSum[i]) / size;
-        float weightForeground = 1.0 - weightBackground;
+        cumulativeSum += histogram[i];
 
-        float meanBackground = static_cast<float>(cumulativeSum[i] * i) / cumulativeSum[i];
-        float meanForeground = (meanIntensity - cumulativeSum[i] * meanBackground / size) / weightForeground;
-        
-        float variance = weightBackground * weightForeground * std::pow((meanBackground - meanForeground), 2.0);
+        double weightBackground = static_cast<double>(cumulativeSum) / size;
+        double weightForeground = 1.0 - weightBackground;
+
+        double meanBackground = static_cast<double>(cumulativeSum) * i / cumulativeSum;
+        double meanForeground = (meanIntensity - cumulativeSum * meanBackground / size) / weightForeground;
+
+        double variance = weightBackground * weightForeground * std::pow(meanBackground - meanForeground, 2.0);
 
         if(variance > maxVariance)
         {
@@ -75,263 +139,2482 @@ float Binarization::ComputeOtsuThreshold(const std::vector<std::vector<uchar>>&
     return threshold;
 }
 
-void Binarization::BinaryThreshold(const std::vector<std::vector<uchar>>& inputImage, std::vector<std::vector<uchar>>& outputImage, float threshold)
+void Binarization::BinaryThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage, float threshold)
 {
-    for (int i = 0; i < inputImage.size(); i++)
+    ThreadPool::ParallelFor(0, inputImage.rows(), [&](int begin, int end)
     {
-        for (int j = 0; j < inputImage[0].size(); j++)
+        for (int i = begin; i < end; i++)
         {
-            outputImage[i][j] = (inputImage[i][j] >= threshold ? 255: 0);
+            const uchar* in = inputImage[i];
+            uchar* out = outputImage[i];
+            for (int j = 0; j < inputImage.cols(); j++)
+            {
+                out[j] = (in[j] >= threshold ? 255: 0);
+            }
         }
-    }
+    }, 64);
 }
 
-void Binarization::OtsuThreshold(const std::vector<std::vector<uchar>>& inputImage, std::vector<std::vector<uchar>>& outputImage)
+void Binarization::BinaryThreshold(ImageView<const uchar> inputImage, BitMask& outputMask, float threshold)
+{
+    outputMask.create(inputImage.rows(), inputImage.cols());
+
+    // Для целых значений in >= threshold <=> in >= ceil(threshold)
+    float limit = std::ceil(threshold);
+    int level = limit <= 0 ? 0 : (limit > 255 ? 256 : static_cast<int>(limit));
+    const ConvolutionKernels& kernels = convolutionKernels();
+
+    ThreadPool::ParallelFor(0, inputImage.rows(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            if (level > 255)
+                std::fill(outputMask.row(i), outputMask.row(i) + outputMask.wordsPerRow(), uint64_t(0));
+            else
+                kernels.thresholdRowBits(inputImage[i], outputMask.row(i), inputImage.cols(), level);
+        }
+    }, 64);
+}
+
+void Binarization::OtsuThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage)
+{
+    Binarization bin;
+
+    std::vector<int> histogram = bin.ComputeHistogram(inputImage);
+    OtsuThreshold(inputImage, outputImage, histogram);
+}
+
+void Binarization::OtsuThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    const std::vector<int>& histogram)
 {
     Binarization bin;
 
-    float threshold = bin.ComputeOtsuThreshold(inputImage);
+    float threshold = bin.ComputeOtsuThreshold(histogram);
     threshold /= 2.4;
     bin.BinaryThreshold(inputImage, outputImage, threshold);
 }
 
+void Binarization::OtsuThreshold(ImageView<const uchar> inputImage, BitMask& outputMask)
+{
+    Binarization bin;
+
+    std::vector<int> histogram = bin.ComputeHistogram(inputImage);
+    OtsuThreshold(inputImage, outputMask, histogram);
+}
+
+void Binarization::OtsuThreshold(ImageView<const uchar> inputImage, BitMask& outputMask,
+    const std::vector<int>& histogram, double divisor)
+{
+    Binarization bin;
+
+    float threshold = bin.ComputeOtsuThreshold(histogram);
+    threshold /= divisor;
+    bin.BinaryThreshold(inputImage, outputMask, threshold);
+}
 
-// Функция для проверки пикселя на границы изображения
-bool Borders::CheckBoundary(int x, int y, int rows, int cols) 
+void Binarization::OtsuThreshold(const std::vector<std::vector<uchar>>& inputImage, std::vector<std::vector<uchar>>& outputImage)
 {
-    return (x >= 0 && y >= 0 && x < rows && y < cols);
+    Image<uchar> input = toImage(inputImage);
+    Image<uchar> output(input.rows(), input.cols());
+
+    Binarization::OtsuThreshold(input, output);
+    toVector(output, outputImage);
 }
 
-// Функция для выполнения поиска в ширину (BFS)
-void Borders::BFS(int x, int y, int label, const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels) 
+void Binarization::AdaptiveThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    Method method, int windowSize, float k, float dynamicRange)
 {
-    int rows = binaryImg.size();
-    int cols = binaryImg[0].size();
+    CV_Assert(windowSize >= 1 && windowSize % 2 == 1);
+
+    int height = inputImage.rows();
+    int width = inputImage.cols();
+    int radius = windowSize / 2;
+
+    // Полосы читают строки соседей, поэтому при записи на месте вход копируется
+    Image<uchar> copy;
+    if (static_cast<const void*>(inputImage.data()) == static_cast<const void*>(outputImage.data()))
+    {
+        copy.create(height, width);
+        for (int i = 0; i < height; i++)
+            std::copy(inputImage[i], inputImage[i] + width, copy[i]);
+        inputImage = copy;
+    }
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end)
+    {
+        // Интегральные изображения строк полосы и ореола шириной в радиус окна:
+        // sum[y][x] - сумма пикселей строк first..first + y - 1 и столбцов 0..x - 1.
+        // Суммы хранятся по модулю 2^32: разность для окна всё равно точна
+        int first = std::max(begin - radius, 0);
+        int last = std::min(end + radius, height);
+        int stride = width + 1;
 
-    std::vector<std::pair<int, int>> queue; // Очередь для BFS
-    queue.push_back(std::make_pair(x, y));
+        uint32_t* sum = ThreadScratch<uint32_t>((last - first + 1) * stride);
+        uint64_t* sqsum = ThreadScratch<uint64_t>((last - first + 1) * stride);
 
-    while (!queue.empty()) 
-    {    
-        int current_x = queue.front().first;
-        int current_y = queue.front().second;
-        queue.erase(queue.begin());
+        std::fill(sum, sum + stride, 0);
+        std::fill(sqsum, sqsum + stride, 0);
 
-        // Проверяем соседние пиксели
-        for (int i = -1; i <= 1; i++) 
+        for (int y = first; y < last; y++)
         {
-            for (int j = -1; j <= 1; j++) 
+            const uchar* in = inputImage[y];
+            const uint32_t* prev = sum + (y - first) * stride;
+            const uint64_t* prevSq = sqsum + (y - first) * stride;
+            uint32_t* cur = sum + (y - first + 1) * stride;
+            uint64_t* curSq = sqsum + (y - first + 1) * stride;
+
+            uint32_t rowSum = 0;
+            uint64_t rowSqSum = 0;
+            cur[0] = 0;
+            curSq[0] = 0;
+
+            for (int x = 0; x < width; x++)
             {
-                if (Borders::CheckBoundary(current_x + i, current_y + j, rows, cols) &&
-                    binaryImg[current_x + i][current_y + j] == 255 &&
-                    labels[current_x + i][current_y + j] == 0)
-                    {
-                        labels[current_x + i][current_y + j] = label;
-                        queue.push_back(std::make_pair(current_x + i, current_y + j));
-                    }
+                rowSum += in[x];
+                rowSqSum += in[x] * in[x];
+                cur[x + 1] = prev[x + 1] + rowSum;
+                curSq[x + 1] = prevSq[x + 1] + rowSqSum;
+            }
+        }
+
+        // Обратные величины ширины окна по столбцам, чтобы не делить в каждом пикселе
+        double* columnScale = ThreadScratch<double>(width);
+        for (int j = 0; j < width; j++)
+            columnScale[j] = 1.0 / (std::min(j + radius + 1, width) - std::max(j - radius, 0));
+
+        for (int i = begin; i < end; i++)
+        {
+            int y0 = std::max(i - radius, 0) - first;
+            int y1 = std::min(i + radius + 1, height) - first;
+            const uint32_t* top = sum + y0 * stride;
+            const uint32_t* bottom = sum + y1 * stride;
+            const uint64_t* topSq = sqsum + y0 * stride;
+            const uint64_t* bottomSq = sqsum + y1 * stride;
+
+            double rowScale = 1.0 / (y1 - y0);
+
+            const uchar* in = inputImage[i];
+            uchar* out = outputImage[i];
+
+            for (int j = 0; j < width; j++)
+            {
+                int x0 = std::max(j - radius, 0);
+                int x1 = std::min(j + radius + 1, width);
+                double scale = rowScale * columnScale[j];
+
+                uint32_t windowSum = bottom[x1] - top[x1] - bottom[x0] + top[x0];
+                uint64_t windowSqSum = bottomSq[x1] - topSq[x1] - bottomSq[x0] + topSq[x0];
+
+                double mean = windowSum * scale;
+                double deviation = std::sqrt(std::max(windowSqSum * scale - mean * mean, 0.0));
+
+                double threshold = method == Method::Niblack
+                    ? mean + k * deviation
+                    : mean * (1.0 + k * (deviation / dynamicRange - 1.0));
+
+                out[j] = in[j] > threshold ? 255 : 0;
             }
         }
+    }, std::max(64, 2 * windowSize));
+}
+
+
+// Функция для обхода единичных пикселей строки i слева направо
+template <typename Func>
+static void ForEachForeground(ImageView<const uchar> binaryImg, int i, Func func)
+{
+    const uchar* row = binaryImg[i];
+    for (int j = 0; j < binaryImg.cols(); j++)
+    {
+        if (row[j] == 255)
+            func(j);
     }
 }
 
+// Для упакованной маски перебираются только единичные биты
+template <typename Func>
+static void ForEachForeground(const BitMask& binaryMask, int i, Func func)
+{
+    const uint64_t* row = binaryMask.row(i);
+    for (int w = 0; w < binaryMask.wordsPerRow(); w++)
+    {
+        for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
+            func(w * 64 + __builtin_ctzll(bits));
+    }
+}
 
-// Функция для выполнения связного компонентного анализа (CCA)
-void Borders::CCA(const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels) 
+// Корень множества метки label со сжатием пути
+static int FindRoot(int* parent, int label)
 {
-    int rows = binaryImg.size();
-    int cols = binaryImg[0].size();
-    int currentLabel = 0;
-    
-    Borders bord;
+    int root = label;
+    while (parent[root] != root)
+        root = parent[root];
+
+    while (parent[label] != root)
+    {
+        int next = parent[label];
+        parent[label] = root;
+        label = next;
+    }
+    return root;
+}
+
+// Объединение множеств: корнем становится меньшая метка, поэтому
+// parent[label] <= label для любой метки
+static int MergeLabels(int* parent, int first, int second)
+{
+    first = FindRoot(parent, first);
+    second = FindRoot(parent, second);
+
+    if (first < second)
+    {
+        parent[second] = first;
+        return first;
+    }
+    parent[first] = second;
+    return second;
+}
+
+void ComponentStats::resize(int count)
+{
+    area.assign(count, 0);
+    left.assign(count, INT_MAX);
+    top.assign(count, INT_MAX);
+    right.assign(count, INT_MIN);
+    bottom.assign(count, INT_MIN);
+    centroidX.assign(count, 0.0);
+    centroidY.assign(count, 0.0);
+    intensitySum.assign(count, 0);
+}
+
+// Накопленная статистика одной временной метки
+struct LabelStats
+{
+    int area = 0;
+    int left = INT_MAX;
+    int top = INT_MAX;
+    int right = INT_MIN;
+    int bottom = INT_MIN;
+    long long sumX = 0;
+    long long sumY = 0;
+    long long intensity = 0;
+};
 
-    // Проходим по каждому пикселю бинаризованного изображения
-    for (int i = 0; i < rows; i++) 
+// Функция для разметки полосы строк [begin, end) независимо от остального
+// изображения: временные метки назначаются по уже размеченным соседям сверху
+// и слева (дерево решений SAUF), строка над полосой считается фоном.
+// Решение принимается по меткам, а не по изображению: у фона метка 0.
+// parent - таблица эквивалентностей полосы, parent[0] - фон. Если stats
+// не nullptr, в него накапливается статистика каждой временной метки
+template <typename Binary>
+static void LabelStrip(const Binary& binaryImg, ImageView<int> labels, int begin, int end,
+    bool eight, std::vector<int>& parent, std::vector<LabelStats>* stats, ImageView<const uchar> intensity)
+{
+    int cols = binaryImg.cols();
+    parent.assign(1, 0);
+    if (stats)
+        stats->assign(1, LabelStats());
+
+    for (int i = begin; i < end; i++)
     {
-        for (int j = 0; j < cols; j++) 
+        int* cur = labels[i];
+        const int* prev = i > begin ? labels[i - 1] : nullptr;
+        const uchar* values = intensity.empty() ? nullptr : intensity[i];
+        std::fill(cur, cur + cols, 0);
+
+        ForEachForeground(binaryImg, i, [&](int j)
         {
-            if (binaryImg[i][j] == 255 && labels[i][j] == 0) {
-                currentLabel++;
-                labels[i][j] = currentLabel;
-                bord.BFS(i, j, currentLabel, binaryImg, labels);
+            int left = j > 0 ? cur[j - 1] : 0;
+            int up = prev ? prev[j] : 0;
+            int label;
+
+            if (eight)
+            {
+                int upLeft = prev && j > 0 ? prev[j - 1] : 0;
+                int upRight = prev && j + 1 < cols ? prev[j + 1] : 0;
+
+                // Верхний сосед связан со всеми остальными
+                if (up)
+                    label = up;
+                else if (upRight)
+                {
+                    if (upLeft)
+                        label = MergeLabels(parent.data(), upRight, upLeft);
+                    else if (left)
+                        label = MergeLabels(parent.data(), upRight, left);
+                    else
+                        label = upRight;
+                }
+                else if (upLeft)
+                    label = upLeft;
+                else
+                    label = left;
             }
-        }
+            else
+            {
+                if (up && left)
+                    label = MergeLabels(parent.data(), up, left);
+                else
+                    label = up ? up : left;
+            }
+
+            if (label == 0)
+            {
+                label = parent.size();
+                parent.push_back(label);
+                if (stats)
+                    stats->push_back(LabelStats());
+            }
+            cur[j] = label;
+
+            if (stats)
+            {
+                LabelStats& st = (*stats)[label];
+                st.area++;
+                st.left = std::min(st.left, j);
+                st.top = std::min(st.top, i);
+                st.right = std::max(st.right, j);
+                st.bottom = i;
+                st.sumX += j;
+                st.sumY += i;
+                if (values)
+                    st.intensity += values[j];
+            }
+        });
     }
 }
 
-void Borders::GetBoundingBox(const std::vector<std::pair<int, int>>& contour, int& minX, int& minY, int& maxX, int& maxY) {
-    // Инициализация переменных координат
-    minX = INT_MAX;
-    minY = INT_MAX;
-    maxX = INT_MIN;
-    maxY = INT_MIN;
+// Изображение делится на горизонтальные полосы, которые размечаются
+// параллельно с локальными метками. Затем метки полос сдвигаются в общую
+// таблицу эквивалентностей, объекты, пересекающие границы полос, объединяются
+// по парам соседних строк, и все метки заменяются номерами корней.
+// Временные метки растут в порядке обхода по строкам, поэтому результат
+// не зависит от числа полос и совпадает с последовательной разметкой
+template <typename Binary>
+int Borders::LabelComponents(const Binary& binaryImg, ImageView<int> labels, Connectivity connectivity,
+    ComponentStats* stats, ImageView<const uchar> intensity)
+{
+    int rows = binaryImg.rows();
+    int cols = binaryImg.cols();
+    bool eight = connectivity == Connectivity::Eight;
 
-    // Поиск минимальных и максимальных координат
-    for (auto point : contour) {
-        if (point.first < minX) {
-            minX = point.first;
-        }
-        if (point.second < minY) {
-            minY = point.second;
-        }
-        if (point.first > maxX) {
-            maxX = point.first;
-        }
-        if (point.second > maxY) {
-            maxY = point.second;
+    // Полосы не короче 64 строк, по несколько на поток
+    int stripCount = std::max(1, std::min(rows / 64, ThreadPool::GetNumThreads() * 4));
+    int stripSize = (rows + stripCount - 1) / stripCount;
+    stripCount = stripSize > 0 ? (rows + stripSize - 1) / stripSize : 0;
+
+    // Таблицы полос хранятся в буферах вызывающего потока и сохраняют
+    // выделенную память между вызовами
+    std::vector<int>* stripParents = ThreadScratch<std::vector<int>>(stripCount);
+    std::vector<LabelStats>* stripStats = ThreadScratch<std::vector<LabelStats>>(stats ? stripCount : 0);
+    ThreadPool::ParallelFor(0, stripCount, [&](int begin, int end)
+    {
+        for (int k = begin; k < end; k++)
+        {
+            LabelStrip(binaryImg, labels, k * stripSize, std::min(rows, (k + 1) * stripSize), eight,
+                stripParents[k], stats ? &stripStats[k] : nullptr, intensity);
         }
+    });
+
+    // Сдвиг меток полосы k в общей таблице
+    int* offsets = ThreadScratch<int, 1>(stripCount + 1);
+    offsets[0] = 0;
+    for (int k = 0; k < stripCount; k++)
+        offsets[k + 1] = offsets[k] + stripParents[k].size() - 1;
+
+    int labelCount = offsets[stripCount] + 1;
+    int* parent = ThreadScratch<int, 2>(labelCount);
+    parent[0] = 0;
+    for (int k = 0; k < stripCount; k++)
+    {
+        for (std::size_t label = 1; label < stripParents[k].size(); label++)
+            parent[offsets[k] + label] = offsets[k] + stripParents[k][label];
     }
-}
 
+    // Объединение объектов через границы полос
+    for (int k = 1; k < stripCount; k++)
+    {
+        const int* prev = labels[k * stripSize - 1];
+        const int* cur = labels[k * stripSize];
 
-// Функция для создания ядря свёртки Гаусса
-std::vector<std::vector<float>> GaussFilter::CreateGaussianKernel(int kernelSize, float sigma) {
-    std::vector<std::vector<float>> kernel(kernelSize, std::vector<float>(kernelSize, 0.0));
-    float s = 2 * sigma * sigma;
-    float sum = 0.0;
-    int radius = kernelSize / 2;
+        for (int j = 0; j < cols; j++)
+        {
+            if (cur[j] == 0)
+                continue;
 
-    for (int x = -radius; x <= radius; x++) {
-        for (int y = -radius; y <= radius; y++) {
-            float r = std::sqrt(x * x + y * y);
-            int i = x + radius;
-            int j = y + radius;
-            kernel[i][j] = (std::exp(-(r * r) / s)) / (M_PI * s);
-            sum += kernel[i][j];
+            int label = offsets[k] + cur[j];
+            int first = eight ? std::max(j - 1, 0) : j;
+            int last = eight ? std::min(j + 1, cols - 1) : j;
+
+            for (int n = first; n <= last; n++)
+            {
+                if (prev[n] != 0)
+                    MergeLabels(parent, label, offsets[k - 1] + prev[n]);
+            }
         }
     }
 
-    // После создания ядра, выполним нормализацию, для получения значений в промежутке [0, 1]
-    for (int i = 0; i < kernelSize; i++) {
-        for (int j = 0; j < kernelSize; j++) {
-            kernel[i][j] /= sum;
+    // Первый пиксель объекта в порядке обхода всегда получает новую метку,
+    // и она наименьшая в своём множестве. Поэтому нумерация корней по
+    // возрастанию совпадает с порядком первых пикселей объектов
+    int count = 0;
+    for (int label = 1; label < labelCount; label++)
+        parent[label] = parent[label] == label ? ++count : parent[parent[label]];
+
+    // Статистика временных меток собирается в их объекты. Суммы целые,
+    // поэтому результат не зависит от порядка сложения
+    if (stats)
+    {
+        stats->resize(count);
+        for (int k = 0; k < stripCount; k++)
+        {
+            for (std::size_t label = 1; label < stripStats[k].size(); label++)
+            {
+                const LabelStats& st = stripStats[k][label];
+                int c = parent[offsets[k] + label] - 1;
+
+                stats->area[c] += st.area;
+                stats->left[c] = std::min(stats->left[c], st.left);
+                stats->top[c] = std::min(stats->top[c], st.top);
+                stats->right[c] = std::max(stats->right[c], st.right);
+                stats->bottom[c] = std::max(stats->bottom[c], st.bottom);
+                stats->centroidX[c] += st.sumX;
+                stats->centroidY[c] += st.sumY;
+                stats->intensitySum[c] += st.intensity;
+            }
+        }
+
+        for (int c = 0; c < count; c++)
+        {
+            stats->centroidX[c] /= stats->area[c];
+            stats->centroidY[c] /= stats->area[c];
         }
     }
 
-    return kernel;
+    ThreadPool::ParallelFor(0, rows, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            int* row = labels[i];
+            int offset = offsets[i / stripSize];
+            for (int j = 0; j < cols; j++)
+                row[j] = row[j] ? parent[offset + row[j]] : 0;
+        }
+    }, 64);
+
+    return count;
 }
 
-// Функция для выполнения размытия по Гауссу
-void GaussFilter::GaussianBlur(const std::vector<std::vector<float>>& inputImage, std::vector<std::vector<float>>& outputImage,
-    int kernelSize, float sigma) 
+int Borders::CCA(ImageView<const uchar> binaryImg, ImageView<int> labels, Connectivity connectivity)
 {
-    GaussFilter gF;
-    // Создадим ядро свёртки
-    std::vector<std::vector<float>> kernel = gF.CreateGaussianKernel(kernelSize, sigma);
+    Borders bord;
+    return bord.LabelComponents(binaryImg, labels, connectivity, nullptr, ImageView<const uchar>());
+}
 
-    int height = inputImage.size();
-    int width = inputImage[0].size();
-    int radius = kernelSize / 2;
+int Borders::CCA(const BitMask& binaryMask, ImageView<int> labels, Connectivity connectivity)
+{
+    Borders bord;
+    return bord.LabelComponents(binaryMask, labels, connectivity, nullptr, ImageView<const uchar>());
+}
 
-    // Цикл для прохождения по всем пикселям изображения
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            float sum = 0.0;
-            float weight = 0.0;
+int Borders::CCA(ImageView<const uchar> binaryImg, ImageView<int> labels, ComponentStats& stats,
+    Connectivity connectivity, ImageView<const uchar> intensity)
+{
+    Borders bord;
+    return bord.LabelComponents(binaryImg, labels, connectivity, &stats, intensity);
+}
 
-            // Цикл для прохождения по матрице свёртки
-            for (int k = -radius; k <= radius; k++) {
-                for (int l = -radius; l <= radius; l++) {
-                    int x = i + k;
-                    int y = j + l;
-
-                    // Применяем ядро, если Х и Y находятся в диапазоне изображения
-                    if (x >= 0 && x < height && y >= 0 && y < width) {
-                        sum += kernel[k + radius][l + radius] * inputImage[x][y];
-                        weight += kernel[k + radius][l + radius];
-                    }
-                }
-            }
+int Borders::CCA(const BitMask& binaryMask, ImageView<int> labels, ComponentStats& stats,
+    Connectivity connectivity, ImageView<const uchar> intensity)
+{
+    Borders bord;
+    return bord.LabelComponents(binaryMask, labels, connectivity, &stats, intensity);
+}
 
-            // Сохраняем полученные значения
-            outputImage[i][j] = sum / weight;
-        }
+// Функция для выделения отрезков единичных пикселей строки i
+static void ExtractRuns(ImageView<const uchar> binaryImg, int i, std::vector<PixelRun>& runs)
+{
+    const uchar* row = binaryImg[i];
+    int cols = binaryImg.cols();
+
+    for (int j = 0; j < cols; j++)
+    {
+        if (row[j] != 255)
+            continue;
+
+        int begin = j;
+        while (j < cols && row[j] == 255)
+            j++;
+        runs.push_back({i, begin, j});
     }
 }
 
-// Функция для расчёта градиента изображения с помощью оператора Собеля
-std::vector<std::vector<float>> sobelOperator(std::vector<std::vector<float>>& image)
-{   
-    // Создаём ядро оператора Собеля для оси Х и оси Y
-    std::vector<std::vector<int>> kernelX = {{1, 0, -1}, {2, 0, -2}, {1, 0, -1}};
-    std::vector<std::vector<int>> kernelY = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
-
-    // Создаём переменные радиуса ядра, значений ширины и высоты изображения 
-    int radius = kernelX.size() / 2;
-    int height = image.size();
-    int width = image[0].size();
-    
-    std::vector<std::vector<float>> res(height, std::vector<float>(width, 0));
+// Для упакованной маски границы отрезков ищутся по словам: начало - младший
+// единичный бит, конец - младший нулевой бит после него
+static void ExtractRuns(const BitMask& binaryMask, int i, std::vector<PixelRun>& runs)
+{
+    const uint64_t* row = binaryMask.row(i);
+    int begin = -1;
 
-    // Цикл для прохождения по каждому пикселю изображения
-    for (int i = 0; i < height; i++)
+    for (int w = 0; w < binaryMask.wordsPerRow(); w++)
     {
-        for (int j = 0; j < width; j++)
+        uint64_t bits = row[w];
+        int base = w * 64;
+
+        // Продолжение отрезка из предыдущего слова
+        if (begin >= 0)
         {
-            float gradX = 0.0f;
-            float gradY = 0.0f;
-            
-            // Цикл для применения ядра оператора Собеля
-            for (int k = -radius; k <= radius; k++)
-            {
-                for (int l = -radius; l <= radius; l++)
-                {
-                    int x = i + k;
-                    int y = j + l;
+            if (~bits == 0)
+                continue;
 
-                    if (x >= 0 && x < height && y >= 0 && y < width)
-                    {
-                        gradX += kernelX[k + radius][l + radius] * image[x][y];
-                        gradY += kernelY[k + radius][l + radius] * image[x][y];
-                    }
-                }
+            int end = __builtin_ctzll(~bits);
+            runs.push_back({i, begin, base + end});
+            begin = -1;
+            bits &= ~uint64_t(0) << end;
+        }
+
+        while (bits != 0)
+        {
+            int start = __builtin_ctzll(bits);
+            uint64_t zeros = ~bits & (~uint64_t(0) << start);
+
+            if (zeros == 0)
+            {
+                begin = base + start;
+                break;
             }
-            // Расчёт значения градиента для каждого пикселя
-            res[i][j] = std::sqrt(gradX * gradX + gradY * gradY);
+
+            int end = __builtin_ctzll(zeros);
+            runs.push_back({i, base + start, base + end});
+            bits &= ~uint64_t(0) << end;
         }
     }
-    
-    return res;
+
+    // Биты за правой границей нулевые, отрезок может не закрыться
+    // только при ширине, кратной 64
+    if (begin >= 0)
+        runs.push_back({i, begin, binaryMask.cols()});
 }
 
-void convertScaleAbs(const std::vector<std::vector<float>>& image, std::vector<std::vector<unsigned char>>& res)
+// Отрезки выделяются параллельно полосами строк, затем отрезки соседних строк
+// просматриваются двумя указателями и пересекающиеся объединяются (union-find
+// по индексам отрезков). Отрезки идут в порядке обхода, поэтому наименьший
+// индекс множества - первый отрезок объекта, и нумерация совпадает с CCA
+template <typename Binary>
+int Borders::LabelRuns(const Binary& binaryImg, RunComponents& components, Connectivity connectivity)
 {
-    float alpha = 255.0 / (image[0][0] + 1e-6);
-    int height = image.size();
-    int width = image[0].size();
+    int rows = binaryImg.rows();
+
+    // Для 8-связности касание по диагонали тоже считается пересечением
+    int touch = connectivity == Connectivity::Eight ? 1 : 0;
+
+    int stripCount = std::max(1, std::min(rows / 64, ThreadPool::GetNumThreads() * 4));
+    int stripSize = (rows + stripCount - 1) / stripCount;
+    stripCount = stripSize > 0 ? (rows + stripSize - 1) / stripSize : 0;
 
-    for (int i = 0; i < height; i++)
+    // Отрезки полос, индекс первого отрезка каждой строки внутри её полосы
+    // и таблица эквивалентностей хранятся в буферах вызывающего потока
+    // и сохраняют выделенную память между вызовами
+    std::vector<PixelRun>* stripRuns = ThreadScratch<std::vector<PixelRun>>(stripCount);
+    int* rowStart = ThreadScratch<int, 1>(rows);
+
+    ThreadPool::ParallelFor(0, stripCount, [&](int begin, int end)
     {
-        for (int j = 0; j < width; j++)
+        for (int k = begin; k < end; k++)
         {
-            res[i][j] = static_cast<unsigned char>(image[i][j] * alpha);
+            std::vector<PixelRun>& runs = stripRuns[k];
+            runs.clear();
+            for (int i = k * stripSize; i < std::min(rows, (k + 1) * stripSize); i++)
+            {
+                rowStart[i] = runs.size();
+                ExtractRuns(binaryImg, i, runs);
+            }
         }
-    }
-}
+    });
 
-float countPixConcentration(cv::Mat& img)
-{
-    unsigned char* img_data = img.data;
-    
-    cv::Size sizes = img.size();
+    // Общий индекс отрезка - сдвиг его полосы плюс индекс внутри полосы
+    int* stripOffsets = ThreadScratch<int, 2>(stripCount + 1);
+    stripOffsets[0] = 0;
+    for (int k = 0; k < stripCount; k++)
+        stripOffsets[k + 1] = stripOffsets[k] + stripRuns[k].size();
+    int runCount = stripOffsets[stripCount];
 
-    unsigned int count = 0;
+    int* parent = ThreadScratch<int, 3>(runCount);
+    for (int r = 0; r < runCount; r++)
+        parent[r] = r;
 
-    for (int k = 0; k < sizes.height; k++) {
-        for (int j = 0; j < sizes.width; j++) {
-            if (img_data[k * img.step + j] == 255)
-                count++;
+    // Отрезки строки i и общий индекс первого из них
+    auto rowRuns = [&](int i, int& first, int& count)
+    {
+        int k = i / stripSize;
+        int next = i + 1 < std::min(rows, (k + 1) * stripSize) ? rowStart[i + 1] : stripRuns[k].size();
+        first = stripOffsets[k] + rowStart[i];
+        count = next - rowStart[i];
+        return stripRuns[k].data() + rowStart[i];
+    };
+
+    for (int i = 1; i < rows; i++)
+    {
+        int prevFirst, prevCount, curFirst, curCount;
+        const PixelRun* prev = rowRuns(i - 1, prevFirst, prevCount);
+        const PixelRun* cur = rowRuns(i, curFirst, curCount);
+        int p = 0;
+        int q = 0;
+
+        while (p < prevCount && q < curCount)
+        {
+            if (prev[p].begin < cur[q].end + touch && cur[q].begin < prev[p].end + touch)
+                MergeLabels(parent, prevFirst + p, curFirst + q);
+
+            // Сдвигается отрезок, который заканчивается раньше
+            if (prev[p].end < cur[q].end)
+                p++;
+            else
+                q++;
         }
     }
 
-    return float(count) / (sizes.height * sizes.width);
-}
+    // Номер объекта для каждого отрезка и число отрезков в объектах
+    int count = 0;
+    std::vector<int>& offsets = components.offsets;
+    offsets.assign(1, 0);
 
+    for (int r = 0; r < runCount; r++)
+    {
+        if (parent[r] == r)
+        {
+            parent[r] = count++;
+            offsets.push_back(0);
+        }
+        else
+            parent[r] = parent[parent[r]];
 
-void drawRectangle(cv::Mat& img, int x, int y, int endX, int endY)
+        offsets[parent[r] + 1]++;
+    }
+
+    for (int c = 0; c < count; c++)
+        offsets[c + 1] += offsets[c];
+
+    // Раскладка отрезков по объектам с сохранением порядка: offsets[c]
+    // служит позицией записи объекта c и после раскладки равен началу
+    // объекта c + 1, поэтому затем таблица сдвигается на один элемент
+    components.runs.resize(runCount);
+    for (int k = 0; k < stripCount; k++)
+    {
+        const std::vector<PixelRun>& runs = stripRuns[k];
+        for (std::size_t l = 0; l < runs.size(); l++)
+            components.runs[offsets[parent[stripOffsets[k] + l]]++] = runs[l];
+    }
+
+    for (int c = count; c > 0; c--)
+        offsets[c] = offsets[c - 1];
+    offsets[0] = 0;
+
+    return count;
+}
+
+int Borders::RunCCA(const BitMask& binaryMask, RunComponents& components, Connectivity connectivity)
+{
+    Borders bord;
+    return bord.LabelRuns(binaryMask, components, connectivity);
+}
+
+int Borders::RunCCA(ImageView<const uchar> binaryImg, RunComponents& components, Connectivity connectivity)
+{
+    Borders bord;
+    return bord.LabelRuns(binaryImg, components, connectivity);
+}
+
+int Borders::CCA(const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels,
+    Connectivity connectivity)
+{
+    Image<uchar> binary = toImage(binaryImg);
+    Image<int> labelsImg(binary.rows(), binary.cols());
+
+    int count = Borders::CCA(binary, labelsImg, connectivity);
+    toVector(labelsImg, labels);
+    return count;
+}
+
+void Borders::GetBoundingBox(Span<const std::pair<int, int>> contour, int& minX, int& minY, int& maxX, int& maxY) {
+    // Инициализация переменных координат
+    minX = INT_MAX;
+    minY = INT_MAX;
+    maxX = INT_MIN;
+    maxY = INT_MIN;
+
+    // Поиск минимальных и максимальных координат
+    for (auto point : contour) {
+        if (point.first < minX) {
+            minX = point.first;
+        }
+        if (point.second < minY) {
+            minY = point.second;
+        }
+        if (point.first > maxX) {
+            maxX = point.first;
+        }
+        if (point.second > maxY) {
+            maxY = point.second;
+        }
+    }
+}
+
+void Borders::CollectPixels(ImageView<const int> labels, int count, PixelLists& lists)
+{
+    std::vector<int>& offsets = lists.offsets;
+    offsets.assign(count + 1, 0);
+
+    // Число пикселей каждой метки
+    for (int i = 0; i < labels.rows(); i++)
+    {
+        const int* row = labels[i];
+        for (int j = 0; j < labels.cols(); j++)
+            offsets[row[j]]++;
+    }
+
+    // Начало списка каждого объекта; пиксели фона отбрасываются
+    int total = 0;
+    for (int c = 1; c <= count; c++)
+    {
+        int size = offsets[c];
+        offsets[c - 1] = total;
+        total += size;
+    }
+    offsets[count] = total;
+
+    // offsets[c] служит позицией записи объекта c + 1 и после раскладки
+    // указывает на конец его списка, то есть на начало следующего
+    lists.coords.resize(total);
+    for (int i = 0; i < labels.rows(); i++)
+    {
+        const int* row = labels[i];
+        for (int j = 0; j < labels.cols(); j++)
+        {
+            if (row[j] != 0)
+                lists.coords[offsets[row[j] - 1]++] = std::make_pair(i, j);
+        }
+    }
+
+    // Сдвиг обратно к началам списков
+    for (int c = count; c > 0; c--)
+        offsets[c] = offsets[c - 1];
+    offsets[0] = 0;
+}
+
+
+// Сначала параллельно по строкам считаются префиксные суммы строк,
+// затем параллельно по полосам столбцов они складываются сверху вниз
+void IntegralImage::Build(ImageView<const uchar> binaryImg)
+{
+    int rows = binaryImg.rows();
+    int cols = binaryImg.cols();
+    table_.create(rows + 1, cols + 1);
+    std::fill(table_.row(0), table_.row(0) + cols + 1, 0u);
+
+    ThreadPool::ParallelFor(0, rows, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const uchar* in = binaryImg[i];
+            unsigned int* out = table_.row(i + 1);
+            unsigned int sum = 0;
+
+            out[0] = 0;
+            for (int j = 0; j < cols; j++)
+            {
+                sum += in[j] == 255;
+                out[j + 1] = sum;
+            }
+        }
+    }, 64);
+
+    AccumulateColumns();
+}
+
+// Число единичных битов слова маски. Сборка не включает инструкцию POPCNT,
+// и __builtin_popcountll становится вызовом __popcountdi2 из libgcc на каждое
+// слово; параллельный подсчёт по полям встраивается в цикл
+static inline int CountBits(uint64_t bits)
+{
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((bits * 0x0101010101010101ull) >> 56);
+}
+
+// Префиксные количества единиц в байте: prefix[b][k] - число единичных
+// битов 0..k байта b, вычисляется при компиляции
+struct BytePrefixCounts
+{
+    uchar prefix[256][8] = {};
+
+    constexpr BytePrefixCounts()
+    {
+        for (int b = 0; b < 256; b++)
+        {
+            int sum = 0;
+            for (int k = 0; k < 8; k++)
+            {
+                sum += (b >> k) & 1;
+                prefix[b][k] = sum;
+            }
+        }
+    }
+};
+
+// Префиксные суммы строки нужны в каждом пикселе, а не по слову целиком,
+// поэтому они считаются побайтно по таблице: один поиск даёт восемь сумм
+void IntegralImage::Build(const BitMask& mask)
+{
+    static constexpr BytePrefixCounts counts;
+
+    int rows = mask.rows();
+    int cols = mask.cols();
+    table_.create(rows + 1, cols + 1);
+    std::fill(table_.row(0), table_.row(0) + cols + 1, 0u);
+
+    ThreadPool::ParallelFor(0, rows, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const uint64_t* in = mask.row(i);
+            unsigned int* out = table_.row(i + 1) + 1;
+            unsigned int sum = 0;
+
+            table_.row(i + 1)[0] = 0;
+            for (int w = 0; w < mask.wordsPerRow(); w++)
+            {
+                uint64_t bits = in[w];
+                int count = std::min(64, cols - w * 64);
+
+                // Нулевые слова не меняют сумму
+                if (bits == 0)
+                    std::fill(out + w * 64, out + w * 64 + count, sum);
+                else
+                {
+                    for (int k = 0; k < count; k += 8)
+                    {
+                        const uchar* prefix = counts.prefix[(bits >> k) & 0xFF];
+                        int n = std::min(8, count - k);
+
+                        for (int l = 0; l < n; l++)
+                            out[w * 64 + k + l] = sum + prefix[l];
+                        // Биты за концом строки нулевые, поэтому к сумме
+                        // прибавляется количество по всему байту
+                        sum += prefix[7];
+                    }
+                }
+            }
+        }
+    }, 64);
+
+    AccumulateColumns();
+}
+
+void IntegralImage::AccumulateColumns()
+{
+    int rows = table_.rows();
+
+    ThreadPool::ParallelFor(1, table_.cols(), [&](int begin, int end)
+    {
+        for (int i = 1; i < rows; i++)
+        {
+            const unsigned int* prev = table_.row(i - 1);
+            unsigned int* cur = table_.row(i);
+            for (int j = begin; j < end; j++)
+                cur[j] += prev[j];
+        }
+    }, 256);
+}
+
+RegionFilter::Config RegionFilter::DefaultConfig()
+{
+    return Config();
+}
+
+template <typename Density>
+int RegionFilter::Filter(ComponentStats& stats, const Density& density, const Config& config)
+{
+    int count = stats.size();
+    const int* area = stats.area.data();
+    const int* left = stats.left.data();
+    const int* top = stats.top.data();
+    const int* right = stats.right.data();
+    const int* bottom = stats.bottom.data();
+    double minDiagonal2 = config.minDiagonal * config.minDiagonal;
+
+    // Условия без ветвлений по столбцам таблицы
+    uchar* keep = ThreadScratch<uchar>(count);
+    for (int i = 0; i < count; i++)
+    {
+        int width = right[i] - left[i];
+        int height = bottom[i] - top[i];
+        double diagonal2 = double(width) * width + double(height) * height;
+
+        keep[i] = (area[i] >= config.minArea) & (diagonal2 > minDiagonal2) &
+            (width > config.minSide) & (height > config.minSide);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!keep[i])
+            continue;
+
+        int width = right[i] - left[i];
+        int height = bottom[i] - top[i];
+        float fill = width > 0 && height > 0
+            ? countPixConcentration(density, cv::Rect(left[i], top[i], width, height)) : 0.0f;
+        keep[i] = fill > config.minFillRatio;
+    }
+
+    // Сжатие столбцов на месте: элемент записывается всегда,
+    // а позиция записи сдвигается только для оставшихся
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        stats.area[kept] = stats.area[i];
+        stats.left[kept] = stats.left[i];
+        stats.top[kept] = stats.top[i];
+        stats.right[kept] = stats.right[i];
+        stats.bottom[kept] = stats.bottom[i];
+        stats.centroidX[kept] = stats.centroidX[i];
+        stats.centroidY[kept] = stats.centroidY[i];
+        stats.intensitySum[kept] = stats.intensitySum[i];
+        kept += keep[i];
+    }
+
+    stats.area.resize(kept);
+    stats.left.resize(kept);
+    stats.top.resize(kept);
+    stats.right.resize(kept);
+    stats.bottom.resize(kept);
+    stats.centroidX.resize(kept);
+    stats.centroidY.resize(kept);
+    stats.intensitySum.resize(kept);
+
+    return kept;
+}
+
+int RegionFilter::Apply(ComponentStats& stats, const BitMask& mask, const Config& config)
+{
+    return Filter(stats, mask, config);
+}
+
+int RegionFilter::Apply(ComponentStats& stats, const IntegralImage& table, const Config& config)
+{
+    return Filter(stats, table, config);
+}
+
+// Функция для создания одномерного ядра свёртки Гаусса.
+// Двумерное ядро Гаусса раскладывается в произведение двух таких ядер,
+// поэтому размытие выполняется двумя проходами: по строкам и по столбцам.
+std::vector<float> GaussFilter::CreateGaussianKernel1D(int kernelSize, float sigma)
+{
+    std::vector<float> kernel(kernelSize, 0.0f);
+    float s = 2 * sigma * sigma;
+    float sum = 0.0;
+    int radius = kernelSize / 2;
+
+    for (int x = -radius; x <= radius; x++) {
+        kernel[x + radius] = std::exp(-(x * x) / s);
+        sum += kernel[x + radius];
+    }
+
+    // Нормализуем ядро, чтобы сумма коэффициентов была равна 1
+    for (int i = 0; i < kernelSize; i++) {
+        kernel[i] /= sum;
+    }
+
+    return kernel;
+}
+
+// Ядро последнего запроса текущего потока: при обработке потока кадров
+// с одними и теми же параметрами оно не создаётся заново
+const std::vector<float>& GaussFilter::CachedGaussianKernel1D(int kernelSize, float sigma)
+{
+    thread_local std::vector<float> kernel;
+    thread_local float kernelSigma = 0.0f;
+
+    if (kernel.size() != static_cast<std::size_t>(kernelSize) || kernelSigma != sigma)
+    {
+        kernel = CreateGaussianKernel1D(kernelSize, sigma);
+        kernelSigma = sigma;
+    }
+
+    return kernel;
+}
+
+// Функция для вычисления индекса пикселя за границей изображения.
+// Возвращает -1, если пиксель не должен учитываться (режимы Constant и Renormalize).
+int borderInterpolate(int p, int len, BorderMode border)
+{
+    if (p >= 0 && p < len)
+        return p;
+
+    switch (border)
+    {
+    case BorderMode::Replicate:
+        return p < 0 ? 0 : len - 1;
+
+    case BorderMode::Reflect:
+        if (len == 1)
+            return 0;
+        do
+        {
+            p = p < 0 ? -p : 2 * (len - 1) - p;
+        } while (p < 0 || p >= len);
+        return p;
+
+    default:
+        return -1;
+    }
+}
+
+// Функция для свёртки одного граничного пикселя строки с одномерным ядром
+template <typename T>
+static float ConvolveBorderPixel(const T* line, int len, int pos, const std::vector<float>& kernel, BorderMode border)
+{
+    int radius = kernel.size() / 2;
+    float sum = 0.0;
+    float weight = 0.0;
+
+    for (int l = -radius; l <= radius; l++) {
+        int p = borderInterpolate(pos + l, len, border);
+
+        if (p >= 0) {
+            sum += kernel[l + radius] * line[p];
+            weight += kernel[l + radius];
+        }
+    }
+
+    return border == BorderMode::Renormalize ? sum / weight : sum;
+}
+
+// Функция для получения строки изображения в виде массива float.
+// Строки типа uchar расширяются во временный буфер.
+static const float* RowAsFloat(const float* row, int /*width*/, float* /*buffer*/)
+{
+    return row;
+}
+
+static const float* RowAsFloat(const uchar* row, int width, float* buffer)
+{
+    for (int j = 0; j < width; j++)
+        buffer[j] = row[j];
+
+    return buffer;
+}
+
+// Проходы сепарабельной свёртки с ядром Гаусса для одной строки.
+// Внутренняя область обрабатывается векторизованными функциями из
+// convolutionKernels() без проверок границ, граничные полосы
+// шириной в радиус ядра - в соответствии с выбранным режимом border.
+// В режиме Renormalize область учитываемых коэффициентов прямоугольная,
+// поэтому нормировка каждого прохода совпадает с нормировкой двумерной свёртки.
+// При K > 0 размер ядра известен при компиляции и используются варианты
+// функций с развёрнутыми циклами по коэффициентам.
+struct GaussianPass
+{
+    const std::vector<float>& kernel;
+    int kernelSize;
+    int radius;
+    int width;
+    BorderMode border;
+
+    // Границы внутренней области по столбцам
+    int innerBegin;
+    int innerEnd;
+
+    BlurRowFunc blurRow;
+    BlurColumnFunc blurColumn;
+    BlurColumnFunc blurColumnAny;
+
+    template <int K>
+    static GaussianPass Create(const std::vector<float>& kernel, int width, BorderMode border)
+    {
+        const ConvolutionKernels& kernels = convolutionKernels();
+        const int kernelSize = K > 0 ? K : kernel.size();
+        const int radius = kernelSize / 2;
+        int innerBegin = std::min(radius, width);
+        int innerEnd = std::max(width - radius, innerBegin);
+
+        GaussianPass pass = {kernel, kernelSize, radius, width, border, innerBegin, innerEnd,
+            kernels.blurRow, kernels.blurColumn, kernels.blurColumn};
+
+        if constexpr (K > 0) {
+            pass.blurRow = kernels.blurRowFixed[fixedKernelIndex(K)];
+            pass.blurColumn = kernels.blurColumnFixed[fixedKernelIndex(K)];
+        }
+
+        return pass;
+    }
+
+    // Горизонтальный проход по строке in; строки uchar расширяются в rowBuffer
+    template <typename T>
+    void Row(const T* row, float* out, float* rowBuffer) const
+    {
+        const float* in = RowAsFloat(row, width, rowBuffer);
+
+        for (int j = 0; j < innerBegin; j++)
+            out[j] = ConvolveBorderPixel(in, width, j, kernel, border);
+
+        blurRow(in + innerBegin - radius, out + innerBegin, innerEnd - innerBegin, kernel.data(), kernelSize);
+
+        for (int j = innerEnd; j < width; j++)
+            out[j] = ConvolveBorderPixel(in, width, j, kernel, border);
+    }
+
+    // Вертикальный проход для строки i: getRow(x) возвращает строку x после
+    // горизонтального прохода. Исходные строки и их веса выбираются один раз,
+    // после чего внутренний цикл по столбцам не содержит ветвлений.
+    // rows и weights - рабочие массивы на kernelSize элементов
+    template <typename GetRow>
+    void Column(int i, int height, GetRow getRow, const float** rows, float* weights, float* out) const
+    {
+        int count = 0;
+        float weight = 0.0;
+
+        for (int k = -radius; k <= radius; k++) {
+            int x = borderInterpolate(i + k, height, border);
+
+            if (x >= 0) {
+                rows[count] = getRow(x);
+                weights[count] = kernel[k + radius];
+                weight += kernel[k + radius];
+                count++;
+            }
+        }
+
+        float scale = border == BorderMode::Renormalize ? 1.0f / weight : 1.0f;
+
+        for (int k = 0; k < count; k++)
+            weights[k] *= scale;
+
+        // У граничных строк в режимах Constant и Renormalize коэффициентов меньше
+        if (count == kernelSize)
+            blurColumn(rows, weights, count, out, width);
+        else
+            blurColumnAny(rows, weights, count, out, width);
+    }
+};
+
+// Функция для выполнения сепарабельной свёртки изображения с ядром Гаусса.
+// Тип входных пикселей (uchar или float) приводится к float построчно.
+template <int K, typename T>
+static void SeparableGaussian(ImageView<const T> inputImage, ImageView<float> outputImage,
+    const std::vector<float>& kernel, BorderMode border)
+{
+    int height = inputImage.rows();
+    int width = inputImage.cols();
+    GaussianPass pass = GaussianPass::Create<K>(kernel, width, border);
+
+    // Полосы строк обрабатываются независимо: горизонтальный проход выполняется
+    // для строк полосы и ореола шириной в радиус ядра, поэтому результат
+    // не зависит от числа потоков
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end) {
+        int first = std::max(begin - pass.radius, 0);
+        int last = std::min(end + pass.radius, height);
+
+        ImageView<float> temp = ThreadScratchImage<float>(last - first, width);
+        float* rowBuffer = ThreadScratch<float, 1>(width);
+        const float** rows = ThreadScratch<const float*>(pass.kernelSize);
+        float* weights = ThreadScratch<float, 2>(pass.kernelSize);
+
+        for (int i = first; i < last; i++)
+            pass.Row(inputImage[i], temp[i - first], rowBuffer);
+
+        auto getRow = [&](int x) { return temp[x - first]; };
+
+        for (int i = begin; i < end; i++)
+            pass.Column(i, height, getRow, rows, weights, outputImage[i]);
+    }, std::max(ROW_GRAIN, 4 * pass.radius));
+}
+
+// Функция для перевода коэффициентов ядра в формат с фиксированной точкой:
+// округлённые веса нормируются на sum, их сумма становится ровно total
+// (поправка округления добавляется к наибольшему коэффициенту)
+template <typename T>
+static void QuantizeWeights(const float* weights, int count, float sum, int total, T* result)
+{
+    int quantized = 0;
+    int largest = 0;
+
+    for (int k = 0; k < count; k++)
+    {
+        result[k] = static_cast<T>(std::lround(weights[k] / sum * total));
+        quantized += result[k];
+
+        if (weights[k] > weights[largest])
+            largest = k;
+    }
+
+    result[largest] += total - quantized;
+}
+
+// Функция для свёртки одного граничного пикселя строки uint8 с ядром Q8.
+// Результат в формате Q8 (значение пикселя, умноженное на 256)
+static ushort ConvolveBorderPixelQ8(const uchar* line, int len, int pos, const std::vector<ushort>& kernel, BorderMode border)
+{
+    int radius = kernel.size() / 2;
+    unsigned int sum = 0;
+    unsigned int weight = 0;
+
+    for (int l = -radius; l <= radius; l++) {
+        int p = borderInterpolate(pos + l, len, border);
+
+        if (p >= 0) {
+            sum += kernel[l + radius] * line[p];
+            weight += kernel[l + radius];
+        }
+    }
+
+    return border == BorderMode::Renormalize ? (sum * 256 + weight / 2) / weight : sum;
+}
+
+// Функция для выполнения сепарабельной свёртки в целых числах.
+// Горизонтальный проход: uint8 * Q8 -> uint16 (значение * 256),
+// вертикальный: uint16 * Q16 -> uint32 с округлением до целого uint8 или int16.
+// Переполнение невозможно: 255 * 256 < 2^16 и 255 * 256 * 2^16 < 2^32.
+// Граничные области обрабатываются так же, как в SeparableGaussian; в режиме
+// Renormalize веса граничных строк заново переводятся в Q16.
+template <typename T>
+static void FixedPointGaussian(ImageView<const uchar> inputImage, ImageView<T> outputImage,
+    const std::vector<float>& kernel, BorderMode border)
+{
+    int height = inputImage.rows();
+    int width = inputImage.cols();
+    const int kernelSize = kernel.size();
+    const int radius = kernelSize / 2;
+
+    int innerBegin = std::min(radius, width);
+    int innerEnd = std::max(width - radius, innerBegin);
+
+    const ConvolutionKernels& kernels = convolutionKernels();
+
+    std::vector<ushort> kernelQ8(kernelSize);
+    std::vector<unsigned int> kernelQ16(kernelSize);
+    QuantizeWeights(kernel.data(), kernelSize, 1.0f, 1 << 8, kernelQ8.data());
+    QuantizeWeights(kernel.data(), kernelSize, 1.0f, 1 << 16, kernelQ16.data());
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end) {
+        int first = std::max(begin - radius, 0);
+        int last = std::min(end + radius, height);
+
+        ImageView<ushort> temp = ThreadScratchImage<ushort>(last - first, width);
+
+        // Горизонтальный проход
+        for (int i = first; i < last; i++) {
+            const uchar* in = inputImage[i];
+            ushort* out = temp[i - first];
+
+            for (int j = 0; j < innerBegin; j++)
+                out[j] = ConvolveBorderPixelQ8(in, width, j, kernelQ8, border);
+
+            kernels.blurRowU8(in + innerBegin - radius, out + innerBegin, innerEnd - innerBegin, kernelQ8.data(), kernelSize);
+
+            for (int j = innerEnd; j < width; j++)
+                out[j] = ConvolveBorderPixelQ8(in, width, j, kernelQ8, border);
+        }
+
+        // Вертикальный проход
+        const ushort** rows = ThreadScratch<const ushort*>(kernelSize);
+        float* subset = ThreadScratch<float>(kernelSize);
+        unsigned int* weights = ThreadScratch<unsigned int>(kernelSize);
+        unsigned int* acc = ThreadScratch<unsigned int, 1>(width);
+
+        for (int i = begin; i < end; i++) {
+            int count = 0;
+            float weight = 0.0;
+
+            for (int k = -radius; k <= radius; k++) {
+                int x = borderInterpolate(i + k, height, border);
+
+                if (x >= 0) {
+                    rows[count] = temp[x - first];
+                    subset[count] = kernel[k + radius];
+                    weights[count] = kernelQ16[k + radius];
+                    weight += kernel[k + radius];
+                    count++;
+                }
+            }
+
+            if (border == BorderMode::Renormalize && count < kernelSize)
+                QuantizeWeights(subset, count, weight, 1 << 16, weights);
+
+            if constexpr (std::is_same<T, uchar>::value)
+                kernels.blurColumnU8(rows, weights, count, acc, outputImage[i], width);
+            else
+                kernels.blurColumnS16(rows, weights, count, acc, outputImage[i], width);
+        }
+    }, std::max(ROW_GRAIN, 4 * radius));
+}
+
+// Коэффициенты рекурсивного фильтра Гаусса третьего порядка
+// (I. T. Young, L. J. van Vliet, "Recursive implementation of the Gaussian filter", 1995)
+struct RecursiveCoefficients
+{
+    float b1;
+    float b2;
+    float b3;
+    float B;
+
+    // Матрица начальных условий обратного прохода на правой границе
+    // (B. Triggs, M. Sdika, "Boundary conditions for Young - van Vliet recursive filtering", 2006):
+    // отклонения y[N], y[N+1], y[N+2] от крайнего пикселя через отклонения w[N-1], w[N-2], w[N-3]
+    float M[3][3];
+};
+
+static RecursiveCoefficients ComputeRecursiveCoefficients(float sigma)
+{
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                            : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    // Коэффициенты заранее делятся на b0, чтобы не делить в каждом пикселе
+    double a[3] = {b1 / b0, b2 / b0, b3 / b0};
+    double B = 1.0 - (b1 + b2 + b3) / b0;
+
+    RecursiveCoefficients c;
+    c.b1 = a[0];
+    c.b2 = a[1];
+    c.b3 = a[2];
+    c.B = B;
+
+    // Матрица начальных условий находится численно: для каждого единичного
+    // начального состояния прямой проход продолжается за границу на входе,
+    // равном нулю, до затухания, после чего выполняется обратный проход
+    int length = static_cast<int>(12 * sigma) + 64;
+    std::vector<double> w(length + 3), y(length + 3);
+
+    for (int m = 0; m < 3; m++)
+    {
+        // w[2] соответствует w[N-1], w[1] - w[N-2], w[0] - w[N-3]
+        std::fill(w.begin(), w.end(), 0.0);
+        w[2 - m] = 1.0;
+
+        for (int n = 3; n < length + 3; n++)
+            w[n] = a[0] * w[n - 1] + a[1] * w[n - 2] + a[2] * w[n - 3];
+
+        std::fill(y.begin(), y.end(), 0.0);
+        for (int n = length - 1; n >= 3; n--)
+            y[n] = B * w[n] + a[0] * y[n + 1] + a[1] * y[n + 2] + a[2] * y[n + 3];
+
+        for (int k = 0; k < 3; k++)
+            c.M[k][m] = y[3 + k];
+    }
+
+    return c;
+}
+
+// Наименьшая sigma, начиная с которой рекурсивный фильтр достаточно точен:
+// при меньших отклонение от свёртки на шуме превышает 4 уровня
+static const float RECURSIVE_MIN_SIGMA = 2.0f;
+
+// Функция для проверки, можно ли выполнить размытие рекурсивным фильтром.
+// Начальные условия фильтра выражаются только для продолжения изображения
+// крайними пикселями или нулями, поэтому BorderMode::Reflect выполняется свёрткой
+static bool UseRecursiveGaussian(float sigma, BorderMode border)
+{
+    return sigma >= RECURSIVE_MIN_SIGMA && border != BorderMode::Reflect;
+}
+
+// Рекурсивный фильтр одной строки: прямой и обратный проход. При replicate
+// за границами продолжаются крайние значения, иначе нули.
+// forward - буфер на count элементов
+static void RecursiveLine(const float* in, float* out, int count, const RecursiveCoefficients& c,
+    bool replicate, float* forward)
+{
+    float first = replicate ? in[0] : 0.0f;
+    float w1 = first, w2 = first, w3 = first;
+    for (int j = 0; j < count; j++) {
+        float w = c.B * in[j] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        forward[j] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    // w1, w2, w3 содержат w[N-1], w[N-2], w[N-3]
+    float u = replicate ? in[count - 1] : 0.0f;
+    float d[3] = {w1 - u, w2 - u, w3 - u};
+    float y1 = u + c.M[0][0] * d[0] + c.M[0][1] * d[1] + c.M[0][2] * d[2];
+    float y2 = u + c.M[1][0] * d[0] + c.M[1][1] * d[1] + c.M[1][2] * d[2];
+    float y3 = u + c.M[2][0] * d[0] + c.M[2][1] * d[1] + c.M[2][2] * d[2];
+
+    for (int j = count - 1; j >= 0; j--) {
+        float y = c.B * forward[j] + c.b1 * y1 + c.b2 * y2 + c.b3 * y3;
+        out[j] = y;
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+    }
+}
+
+// Обратные веса для режима Renormalize: результат фильтра с нулями за границей
+// делится на отклик того же фильтра на строку из единиц, то есть на суммарный
+// вес пикселей изображения, как при свёртке
+static std::vector<float> RecursiveInverseWeights(int count, const RecursiveCoefficients& c)
+{
+    std::vector<float> ones(count, 1.0f), weights(count), forward(count);
+    RecursiveLine(ones.data(), weights.data(), count, c, false, forward.data());
+
+    for (float& w : weights)
+        w = 1.0f / w;
+    return weights;
+}
+
+// Функция для рекурсивного размытия по Гауссу.
+// Каждый проход (по строкам и по столбцам) состоит из прямого и обратного
+// рекурсивного фильтра, поэтому число операций на пиксель не зависит от sigma.
+// За границами изображения значения продолжаются крайними пикселями
+// (Replicate) или нулями (Constant, Renormalize); в режиме Renormalize
+// результат каждого прохода нормируется по весу пикселей изображения.
+template <typename T>
+static void RecursiveGaussian(ImageView<const T> inputImage, ImageView<float> outputImage, float sigma,
+    BorderMode border)
+{
+    if (inputImage.empty())
+        return;
+
+    int height = inputImage.rows();
+    int width = inputImage.cols();
+    RecursiveCoefficients c = ComputeRecursiveCoefficients(sigma);
+    bool replicate = border == BorderMode::Replicate;
+    bool renormalize = border == BorderMode::Renormalize;
+
+    std::vector<float> rowWeights, columnWeights;
+    if (renormalize) {
+        rowWeights = RecursiveInverseWeights(width, c);
+        columnWeights = RecursiveInverseWeights(height, c);
+    }
+
+    // Горизонтальный проход, результат сразу пишется в выходное изображение
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end) {
+        float* rowBuffer = ThreadScratch<float, 1>(width);
+        float* forward = ThreadScratch<float, 2>(width);
+
+        for (int i = begin; i < end; i++) {
+            const float* in = RowAsFloat(inputImage[i], width, rowBuffer);
+            float* out = outputImage[i];
+
+            RecursiveLine(in, out, width, c, replicate, forward);
+
+            if (renormalize) {
+                for (int j = 0; j < width; j++)
+                    out[j] *= rowWeights[j];
+            }
+        }
+    }, ROW_GRAIN);
+
+    // Вертикальный проход выполняется на месте целыми строками,
+    // чтобы внутренний цикл шёл по соседним в памяти пикселям.
+    // Столбцы независимы, поэтому потоки получают полосы столбцов.
+    // first и last - значения за верхней и нижней границей
+    std::vector<float> first(width, 0.0f), last(width, 0.0f);
+    if (replicate) {
+        first.assign(outputImage[0], outputImage[0] + width);
+        last.assign(outputImage[height - 1], outputImage[height - 1] + width);
+    }
+    std::vector<float> tail(3 * width);
+
+    ThreadPool::ParallelFor(0, width, [&](int begin, int end) {
+        for (int i = 0; i < height; i++) {
+            float* cur = outputImage[i];
+            const float* p1 = i >= 1 ? outputImage[i - 1] : first.data();
+            const float* p2 = i >= 2 ? outputImage[i - 2] : first.data();
+            const float* p3 = i >= 3 ? outputImage[i - 3] : first.data();
+
+            for (int j = begin; j < end; j++)
+                cur[j] = c.B * cur[j] + c.b1 * p1[j] + c.b2 * p2[j] + c.b3 * p3[j];
+        }
+
+        // Начальные условия обратного прохода для строк N, N+1, N+2
+        const float* w[3];
+        for (int m = 0; m < 3; m++)
+            w[m] = height - 1 - m >= 0 ? outputImage[height - 1 - m] : first.data();
+
+        for (int k = 0; k < 3; k++) {
+            float* t = tail.data() + k * width;
+
+            for (int j = begin; j < end; j++) {
+                float u = last[j];
+                t[j] = u + c.M[k][0] * (w[0][j] - u) + c.M[k][1] * (w[1][j] - u) + c.M[k][2] * (w[2][j] - u);
+            }
+        }
+
+        for (int i = height - 1; i >= 0; i--) {
+            float* cur = outputImage[i];
+            const float* n1 = i + 1 < height ? outputImage[i + 1] : tail.data() + (i + 1 - height) * width;
+            const float* n2 = i + 2 < height ? outputImage[i + 2] : tail.data() + (i + 2 - height) * width;
+            const float* n3 = i + 3 < height ? outputImage[i + 3] : tail.data() + (i + 3 - height) * width;
+
+            for (int j = begin; j < end; j++)
+                cur[j] = c.B * cur[j] + c.b1 * n1[j] + c.b2 * n2[j] + c.b3 * n3[j];
+        }
+
+        // Нормировка - после обратного прохода, который читает ненормированные строки
+        if (renormalize) {
+            for (int i = 0; i < height; i++) {
+                float* cur = outputImage[i];
+                for (int j = begin; j < end; j++)
+                    cur[j] *= columnWeights[i];
+            }
+        }
+    }, 64);
+}
+
+// Размер ядра свёртки, заменяющей рекурсивный фильтр: 2 * ceil(3 * sigma) + 1
+static int RecursiveFallbackKernelSize(float sigma)
+{
+    return 2 * static_cast<int>(std::ceil(3.0f * sigma)) + 1;
+}
+
+// Функция для выполнения размытия по Гауссу
+void GaussFilter::GaussianBlur(ImageView<const float> inputImage, ImageView<float> outputImage,
+    int kernelSize, float sigma, BorderMode border, Engine engine)
+{
+    if (engine == Engine::Recursive)
+    {
+        if (UseRecursiveGaussian(sigma, border))
+        {
+            RecursiveGaussian(inputImage, outputImage, sigma, border);
+            return;
+        }
+        kernelSize = RecursiveFallbackKernelSize(sigma);
+    }
+
+    // Для распространённых размеров ядра используются версии с размером,
+    // известным при компиляции
+    switch (kernelSize)
+    {
+    case 3: GaussianBlur<3>(inputImage, outputImage, sigma, border); return;
+    case 5: GaussianBlur<5>(inputImage, outputImage, sigma, border); return;
+    case 7: GaussianBlur<7>(inputImage, outputImage, sigma, border); return;
+    case 9: GaussianBlur<9>(inputImage, outputImage, sigma, border); return;
+    }
+
+    GaussFilter gF;
+    // Создадим ядро свёртки
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(kernelSize, sigma);
+
+    SeparableGaussian<0>(inputImage, outputImage, kernel, border);
+}
+
+void GaussFilter::GaussianBlur(ImageView<const uchar> inputImage, ImageView<float> outputImage,
+    int kernelSize, float sigma, BorderMode border, Engine engine)
+{
+    if (engine == Engine::Recursive)
+    {
+        if (UseRecursiveGaussian(sigma, border))
+        {
+            RecursiveGaussian(inputImage, outputImage, sigma, border);
+            return;
+        }
+        kernelSize = RecursiveFallbackKernelSize(sigma);
+    }
+
+    switch (kernelSize)
+    {
+    case 3: GaussianBlur<3>(inputImage, outputImage, sigma, border); return;
+    case 5: GaussianBlur<5>(inputImage, outputImage, sigma, border); return;
+    case 7: GaussianBlur<7>(inputImage, outputImage, sigma, border); return;
+    case 9: GaussianBlur<9>(inputImage, outputImage, sigma, border); return;
+    }
+
+    GaussFilter gF;
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(kernelSize, sigma);
+
+    SeparableGaussian<0>(inputImage, outputImage, kernel, border);
+}
+
+template <int K>
+void GaussFilter::GaussianBlur(ImageView<const float> inputImage, ImageView<float> outputImage,
+    float sigma, BorderMode border)
+{
+    static_assert(fixedKernelIndex(K) >= 0, "K must be 3, 5, 7 or 9");
+
+    GaussFilter gF;
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(K, sigma);
+
+    SeparableGaussian<K>(inputImage, outputImage, kernel, border);
+}
+
+template <int K>
+void GaussFilter::GaussianBlur(ImageView<const uchar> inputImage, ImageView<float> outputImage,
+    float sigma, BorderMode border)
+{
+    static_assert(fixedKernelIndex(K) >= 0, "K must be 3, 5, 7 or 9");
+
+    GaussFilter gF;
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(K, sigma);
+
+    SeparableGaussian<K>(inputImage, outputImage, kernel, border);
+}
+
+template void GaussFilter::GaussianBlur<3>(ImageView<const float>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<5>(ImageView<const float>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<7>(ImageView<const float>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<9>(ImageView<const float>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<3>(ImageView<const uchar>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<5>(ImageView<const uchar>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<7>(ImageView<const uchar>, ImageView<float>, float, BorderMode);
+template void GaussFilter::GaussianBlur<9>(ImageView<const uchar>, ImageView<float>, float, BorderMode);
+
+void GaussFilter::GaussianBlur(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    int kernelSize, float sigma, BorderMode border)
+{
+    GaussFilter gF;
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(kernelSize, sigma);
+
+    FixedPointGaussian(inputImage, outputImage, kernel, border);
+}
+
+void GaussFilter::GaussianBlur(ImageView<const uchar> inputImage, ImageView<short> outputImage,
+    int kernelSize, float sigma, BorderMode border)
+{
+    GaussFilter gF;
+    std::vector<float> kernel = gF.CreateGaussianKernel1D(kernelSize, sigma);
+
+    FixedPointGaussian(inputImage, outputImage, kernel, border);
+}
+
+void GaussFilter::GaussianBlur(const std::vector<std::vector<float>>& inputImage, std::vector<std::vector<float>>& outputImage,
+    int kernelSize, float sigma)
+{
+    Image<float> input = toImage(inputImage);
+    Image<float> output(input.rows(), input.cols());
+
+    GaussFilter::GaussianBlur(input, output, kernelSize, sigma);
+    toVector(output, outputImage);
+}
+
+// Создаём ядро оператора Собеля для оси Х и оси Y
+static const int SOBEL_KERNEL_X[3][3] = {{1, 0, -1}, {2, 0, -2}, {1, 0, -1}};
+static const int SOBEL_KERNEL_Y[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+// Функция для расчёта компонент градиента в граничном пикселе. rows - строки i - 1, i, i + 1
+// с учётом режима border (nullptr - строка за границей, не учитывается)
+static void SobelBorderPixel(const float* const* rows, int width, int j, BorderMode border, float& gradX, float& gradY)
+{
+    gradX = 0.0f;
+    gradY = 0.0f;
+
+    for (int k = -1; k <= 1; k++)
+    {
+        const float* row = rows[k + 1];
+        if (!row)
+            continue;
+
+        for (int l = -1; l <= 1; l++)
+        {
+            int y = borderInterpolate(j + l, width, border);
+            if (y < 0)
+                continue;
+
+            gradX += SOBEL_KERNEL_X[k + 1][l + 1] * row[y];
+            gradY += SOBEL_KERNEL_Y[k + 1][l + 1] * row[y];
+        }
+    }
+}
+
+// Функция для расчёта строки градиента по трём соседним строкам изображения.
+// borderRow - строка лежит на границе изображения, и rows могут быть
+// отражены или отсутствовать; такие строки обрабатываются без векторизации.
+// Компоненты градиента записываются в outX и outY, если они не равны nullptr.
+static void SobelRow3x3(const float* const* rows, int width, bool borderRow, float* out,
+    float* outX, float* outY, BorderMode border)
+{
+    auto borderPixel = [&](int j)
+    {
+        float gradX, gradY;
+        SobelBorderPixel(rows, width, j, border, gradX, gradY);
+
+        out[j] = std::sqrt(gradX * gradX + gradY * gradY);
+        if (outX)
+            outX[j] = gradX;
+        if (outY)
+            outY[j] = gradY;
+    };
+
+    if (borderRow || width < 3)
+    {
+        for (int j = 0; j < width; j++)
+            borderPixel(j);
+        return;
+    }
+
+    // Расчёт значения градиента для внутренних пикселей строки
+    borderPixel(0);
+    convolutionKernels().sobelRow(rows[0] + 1, rows[1] + 1, rows[2] + 1, out + 1,
+        outX ? outX + 1 : nullptr, outY ? outY + 1 : nullptr, width - 2);
+    borderPixel(width - 1);
+}
+
+// Максимум значений изображения, собираемый по полосам ParallelFor:
+// каждая полоса находит максимум своих строк, пока они в кэше, и сливает его сюда
+class BandMaximum
+{
+public:
+    void Merge(float bandMax)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        value_ = std::max(value_, bandMax);
+    }
+
+    float value() const { return value_; }
+
+private:
+    std::mutex mutex_;
+    float value_ = 0.0f;
+};
+
+static float RowMaximum(const float* row, int width, float maxValue)
+{
+    for (int j = 0; j < width; j++)
+        maxValue = std::max(maxValue, row[j]);
+    return maxValue;
+}
+
+// Функция для квантования направления градиента (коды GradientOrientation)
+static void QuantizeOrientation(const float* gradX, const float* gradY, uchar* out, int count)
+{
+    // tg(22.5) и tg(67.5)
+    const float tan22 = 0.41421356f;
+    const float tan67 = 2.41421356f;
+
+    for (int j = 0; j < count; j++)
+    {
+        float ax = std::fabs(gradX[j]);
+        float ay = std::fabs(gradY[j]);
+        GradientOrientation code;
+
+        if (ay <= tan22 * ax)
+            code = GradientOrientation::Horizontal;
+        else if (ay > tan67 * ax)
+            code = GradientOrientation::Vertical;
+        else
+            code = (gradX[j] > 0) == (gradY[j] > 0) ? GradientOrientation::AntiDiagonal : GradientOrientation::Diagonal;
+
+        out[j] = static_cast<uchar>(code);
+    }
+}
+
+// Функция для расчёта градиента изображения с помощью оператора Собеля 3x3.
+// Пиксели за границей изображения берутся в соответствии с режимом border;
+// режим Renormalize для производной не имеет смысла и совпадает с Constant.
+// gradX, gradY и orientation заполняются, если они не пусты.
+// Если maxValue не nullptr, в него записывается максимум модуля градиента.
+static void Sobel3x3(ImageView<const float> image, ImageView<float> magnitude, ImageView<float> gradX,
+    ImageView<float> gradY, ImageView<uchar> orientation, BorderMode border, float* maxValue = nullptr)
+{   
+    int height = image.rows();
+    int width = image.cols();
+    BandMaximum maximum;
+
+    // Цикл для прохождения по каждой строке изображения
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end)
+    {
+        // Для направления нужны компоненты, даже если вызывающий код их не запросил
+        float* scratchX = orientation.empty() || !gradX.empty() ? nullptr : ThreadScratch<float>(width);
+        float* scratchY = orientation.empty() || !gradY.empty() ? nullptr : ThreadScratch<float, 1>(width);
+        float bandMax = 0.0f;
+
+        for (int i = begin; i < end; i++)
+        {
+            const float* rows[3];
+            for (int k = -1; k <= 1; k++)
+            {
+                int x = borderInterpolate(i + k, height, border);
+                rows[k + 1] = x < 0 ? nullptr : image[x];
+            }
+
+            float* outX = gradX.empty() ? scratchX : gradX[i];
+            float* outY = gradY.empty() ? scratchY : gradY[i];
+
+            // Граничные строки и столбцы обрабатываются отдельно
+            SobelRow3x3(rows, width, i == 0 || i == height - 1, magnitude[i], outX, outY, border);
+
+            if (!orientation.empty())
+                QuantizeOrientation(outX, outY, orientation[i], width);
+            if (maxValue)
+                bandMax = RowMaximum(magnitude[i], width, bandMax);
+        }
+
+        if (maxValue)
+            maximum.Merge(bandMax);
+    }, ROW_GRAIN);
+
+    if (maxValue)
+        *maxValue = maximum.value();
+}
+
+// Функция для размытия по Гауссу и расчёта модуля градиента оператором
+// Собеля 3x3 за один проход. Размытое изображение целиком не хранится:
+// каждая полоса строк держит кольцевой буфер из kernelSize + 2 строк после
+// горизонтального прохода и кольцевой буфер из трёх размытых строк, поэтому
+// рабочий объём памяти зависит только от ширины изображения.
+// Результат совпадает с GaussianBlur, за которым следует sobelOperator.
+// Возвращается максимум модуля градиента, найденный по записанным строкам.
+template <int K, typename T>
+static float FusedGaussianSobel(ImageView<const T> image, ImageView<float> magnitude,
+    const std::vector<float>& kernel, BorderMode blurBorder, BorderMode sobelBorder)
+{
+    int height = image.rows();
+    int width = image.cols();
+    GaussianPass pass = GaussianPass::Create<K>(kernel, width, blurBorder);
+    BandMaximum maximum;
+
+    // Строки, которые требуются для размытой строки x, лежат в окне
+    // [x - radius, x + radius]; размытые строки запрашиваются с возвратом
+    // не больше чем на две строки назад (отражение у верхней границы),
+    // поэтому кольцевому буферу нужно kernelSize + 2 ячейки
+    const int ringSize = pass.kernelSize + 2;
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end) {
+        ImageView<float> ring = ThreadScratchImage<float>(ringSize, width);
+        ImageView<float> blurred = ThreadScratchImage<float, 3>(3, width);
+        int* ringRows = ThreadScratch<int>(ringSize + 3);
+        int* blurredRows = ringRows + ringSize;
+
+        float* rowBuffer = ThreadScratch<float, 1>(width);
+        const float** rows = ThreadScratch<const float*>(pass.kernelSize);
+        float* weights = ThreadScratch<float, 2>(pass.kernelSize);
+
+        // В ячейках записаны номера хранящихся строк, -1 - ячейка пуста
+        std::fill(ringRows, ringRows + ringSize + 3, -1);
+
+        auto horizontalRow = [&](int x) {
+            float* row = ring[x % ringSize];
+            if (ringRows[x % ringSize] != x) {
+                pass.Row(image[x], row, rowBuffer);
+                ringRows[x % ringSize] = x;
+            }
+            return row;
+        };
+
+        auto blurredRow = [&](int x) {
+            float* row = blurred[x % 3];
+            if (blurredRows[x % 3] != x) {
+                pass.Column(x, height, horizontalRow, rows, weights, row);
+                blurredRows[x % 3] = x;
+            }
+            return row;
+        };
+
+        float bandMax = 0.0f;
+
+        for (int i = begin; i < end; i++) {
+            const float* sobelRows[3];
+            for (int k = -1; k <= 1; k++)
+            {
+                int x = borderInterpolate(i + k, height, sobelBorder);
+                sobelRows[k + 1] = x < 0 ? nullptr : blurredRow(x);
+            }
+
+            SobelRow3x3(sobelRows, width, i == 0 || i == height - 1, magnitude[i], nullptr, nullptr, sobelBorder);
+            bandMax = RowMaximum(magnitude[i], width, bandMax);
+        }
+
+        maximum.Merge(bandMax);
+    }, std::max(ROW_GRAIN, 4 * pass.radius));
+
+    return maximum.value();
+}
+
+float GaussFilter::GaussianSobel(ImageView<const float> image, ImageView<float> magnitude,
+    int kernelSize, float sigma, BorderMode blurBorder, BorderMode sobelBorder)
+{
+    GaussFilter gF;
+    const std::vector<float>& kernel = gF.CachedGaussianKernel1D(kernelSize, sigma);
+
+    switch (kernelSize)
+    {
+    case 3: return FusedGaussianSobel<3>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 5: return FusedGaussianSobel<5>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 7: return FusedGaussianSobel<7>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 9: return FusedGaussianSobel<9>(image, magnitude, kernel, blurBorder, sobelBorder);
+    }
+
+    return FusedGaussianSobel<0>(image, magnitude, kernel, blurBorder, sobelBorder);
+}
+
+float GaussFilter::GaussianSobel(ImageView<const uchar> image, ImageView<float> magnitude,
+    int kernelSize, float sigma, BorderMode blurBorder, BorderMode sobelBorder)
+{
+    GaussFilter gF;
+    const std::vector<float>& kernel = gF.CachedGaussianKernel1D(kernelSize, sigma);
+
+    switch (kernelSize)
+    {
+    case 3: return FusedGaussianSobel<3>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 5: return FusedGaussianSobel<5>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 7: return FusedGaussianSobel<7>(image, magnitude, kernel, blurBorder, sobelBorder);
+    case 9: return FusedGaussianSobel<9>(image, magnitude, kernel, blurBorder, sobelBorder);
+    }
+
+    return FusedGaussianSobel<0>(image, magnitude, kernel, blurBorder, sobelBorder);
+}
+
+// Коэффициенты сепарабельного оператора Собеля размера K x K:
+// сглаживание - биномиальные коэффициенты порядка K - 1,
+// производная - биномиальные коэффициенты порядка K - 2, свёрнутые с [1, -1].
+// Для K = 3 это [1, 2, 1] и [1, 0, -1].
+static constexpr void FillSobelWeights(int size, int* smooth, int* deriv, int* binom)
+{
+    for (int i = 0; i < size; i++)
+        binom[i] = 0;
+    binom[0] = 1;
+
+    for (int n = 1; n <= size - 2; n++)
+        for (int i = n; i > 0; i--)
+            binom[i] += binom[i - 1];
+
+    for (int i = 0; i < size; i++)
+    {
+        int cur = i < size - 1 ? binom[i] : 0;
+        int prev = i > 0 ? binom[i - 1] : 0;
+        smooth[i] = cur + prev;
+        deriv[i] = cur - prev;
+    }
+}
+
+// Ядро размера K, вычисленное при компиляции
+template <int K>
+struct SobelKernel
+{
+    static constexpr int size = K;
+    int smooth[K] = {};
+    int deriv[K] = {};
+
+    constexpr SobelKernel()
+    {
+        int binom[K] = {};
+        FillSobelWeights(K, smooth, deriv, binom);
+    }
+};
+
+// Ядро произвольного нечётного размера
+struct DynamicSobelKernel
+{
+    int size;
+    std::vector<int> smooth;
+    std::vector<int> deriv;
+
+    explicit DynamicSobelKernel(int kernelSize)
+        : size(kernelSize), smooth(kernelSize), deriv(kernelSize)
+    {
+        std::vector<int> binom(kernelSize);
+        FillSobelWeights(kernelSize, smooth.data(), deriv.data(), binom.data());
+    }
+};
+
+// Функция для расчёта градиента сепарабельным оператором Собеля.
+// Для каждой строки сначала вычисляются сглаженная и продифференцированная
+// по вертикали строки (с отступами по краям для граничных столбцов),
+// затем к ним применяются горизонтальные ядра.
+// Если maxValue не nullptr, в него записывается максимум модуля градиента.
+template <typename Kernel>
+static Image<float> SobelSeparable(ImageView<const float> image, const Kernel& kernel, BorderMode border,
+    float* maxValue = nullptr)
+{
+    const int size = kernel.size;
+    const int radius = size / 2;
+    int height = image.rows();
+    int width = image.cols();
+
+    Image<float> res(height, width);
+    BandMaximum maximum;
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end)
+    {
+        float* smoothRow = ThreadScratch<float>(width + 2 * radius);
+        float* derivRow = ThreadScratch<float, 1>(width + 2 * radius);
+        float* vs = smoothRow + radius;
+        float* vd = derivRow + radius;
+        float bandMax = 0.0f;
+
+        for (int i = begin; i < end; i++)
+        {
+            std::fill(smoothRow, smoothRow + width + 2 * radius, 0.0f);
+            std::fill(derivRow, derivRow + width + 2 * radius, 0.0f);
+
+            // Вертикальный проход: сглаживание для gradX и производная для gradY
+            for (int k = 0; k < size; k++)
+            {
+                int x = borderInterpolate(i + k - radius, height, border);
+                if (x < 0)
+                    continue;
+
+                const float* src = image[x];
+                float ws = kernel.smooth[k];
+                float wd = -kernel.deriv[k];
+
+                for (int j = 0; j < width; j++)
+                {
+                    vs[j] += ws * src[j];
+                    vd[j] += wd * src[j];
+                }
+            }
+
+            // Заполняем отступы за левой и правой границей строки
+            for (int p = 1; p <= radius; p++)
+            {
+                int left = borderInterpolate(-p, width, border);
+                int right = borderInterpolate(width - 1 + p, width, border);
+
+                vs[-p] = left < 0 ? 0.0f : vs[left];
+                vd[-p] = left < 0 ? 0.0f : vd[left];
+                vs[width - 1 + p] = right < 0 ? 0.0f : vs[right];
+                vd[width - 1 + p] = right < 0 ? 0.0f : vd[right];
+            }
+
+            // Горизонтальный проход
+            float* out = res[i];
+            for (int j = 0; j < width; j++)
+            {
+                float gradX = 0.0f;
+                float gradY = 0.0f;
+
+                for (int l = 0; l < size; l++)
+                {
+                    gradX += kernel.deriv[l] * vs[j + l - radius];
+                    gradY += kernel.smooth[l] * vd[j + l - radius];
+                }
+
+                out[j] = std::sqrt(gradX * gradX + gradY * gradY);
+                bandMax = std::max(bandMax, out[j]);
+            }
+        }
+
+        maximum.Merge(bandMax);
+    }, ROW_GRAIN);
+
+    if (maxValue)
+        *maxValue = maximum.value();
+    return res;
+}
+
+template <int K>
+static Image<float> SobelFixed(ImageView<const float> image, BorderMode border, float* maxValue)
+{
+    static_assert(fixedKernelIndex(K) >= 0, "K must be 3, 5, 7 or 9");
+
+    if constexpr (K == 3)
+    {
+        Image<float> res(image.rows(), image.cols());
+        Sobel3x3(image, res, ImageView<float>(), ImageView<float>(), ImageView<uchar>(), border, maxValue);
+        return res;
+    }
+    else
+    {
+        static constexpr SobelKernel<K> kernel;
+        return SobelSeparable(image, kernel, border, maxValue);
+    }
+}
+
+template <int K>
+Image<float> sobelOperator(ImageView<const float> image, BorderMode border)
+{
+    return SobelFixed<K>(image, border, nullptr);
+}
+
+template Image<float> sobelOperator<3>(ImageView<const float>, BorderMode);
+template Image<float> sobelOperator<5>(ImageView<const float>, BorderMode);
+template Image<float> sobelOperator<7>(ImageView<const float>, BorderMode);
+template Image<float> sobelOperator<9>(ImageView<const float>, BorderMode);
+
+Image<float> sobelOperator(ImageView<const float> image, BorderMode border)
+{
+    return sobelOperator<3>(image, border);
+}
+
+void sobelOperator(ImageView<const float> image, ImageView<float> magnitude, ImageView<float> gradX,
+    ImageView<float> gradY, ImageView<uchar> orientation, BorderMode border)
+{
+    auto sameSize = [&](int rows, int cols, bool empty)
+    {
+        return empty || (rows == image.rows() && cols == image.cols());
+    };
+
+    CV_Assert(sameSize(magnitude.rows(), magnitude.cols(), false));
+    CV_Assert(sameSize(gradX.rows(), gradX.cols(), gradX.empty()));
+    CV_Assert(sameSize(gradY.rows(), gradY.cols(), gradY.empty()));
+    CV_Assert(sameSize(orientation.rows(), orientation.cols(), orientation.empty()));
+
+    Sobel3x3(image, magnitude, gradX, gradY, orientation, border);
+}
+
+Image<float> sobelOperator(ImageView<const float> image, int kernelSize, BorderMode border, float* maxValue)
+{
+    CV_Assert(kernelSize >= 3 && kernelSize % 2 == 1);
+
+    // Для распространённых размеров используются версии с ядром,
+    // вычисленным при компиляции
+    switch (kernelSize)
+    {
+    case 3: return SobelFixed<3>(image, border, maxValue);
+    case 5: return SobelFixed<5>(image, border, maxValue);
+    case 7: return SobelFixed<7>(image, border, maxValue);
+    case 9: return SobelFixed<9>(image, border, maxValue);
+    }
+
+    return SobelSeparable(image, DynamicSobelKernel(kernelSize), border, maxValue);
+}
+
+std::vector<std::vector<float>> sobelOperator(std::vector<std::vector<float>>& image)
+{
+    std::vector<std::vector<float>> res;
+    toVector(sobelOperator(toImage(image)), res);
+    return res;
+}
+
+// Функция для вертикального прохода целочисленного оператора Собеля
+static void SobelColumn(const ConvolutionKernels& kernels, const uchar* const* rows, short* smooth, short* deriv, int count)
+{
+    kernels.sobelColumnU8(rows[0], rows[1], rows[2], smooth, deriv, count);
+}
+
+static void SobelColumn(const ConvolutionKernels& kernels, const short* const* rows, short* smooth, short* deriv, int count)
+{
+    kernels.sobelColumnS16(rows[0], rows[1], rows[2], smooth, deriv, count);
+}
+
+// Функция для расчёта компонент градиента целочисленным оператором Собеля.
+// Для каждой строки вертикальный проход даёт сглаженную и продифференцированную
+// строки с отступом в один пиксель по краям, горизонтальный - gx и gy.
+// Строки за границей в режимах Constant и Renormalize заменяются нулевой строкой.
+template <typename T>
+static void SobelInt(ImageView<const T> image, ImageView<short> gradX, ImageView<short> gradY, BorderMode border)
+{
+    int height = image.rows();
+    int width = image.cols();
+    const ConvolutionKernels& kernels = convolutionKernels();
+
+    int left = borderInterpolate(-1, width, border);
+    int right = borderInterpolate(width, width, border);
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end)
+    {
+        short* smooth = ThreadScratch<short>(width + 2);
+        short* deriv = ThreadScratch<short, 1>(width + 2);
+        T* zeros = ThreadScratch<T, 2>(width);
+        std::fill(zeros, zeros + width, 0);
+
+        for (int i = begin; i < end; i++)
+        {
+            const T* rows[3];
+            for (int k = -1; k <= 1; k++)
+            {
+                int x = borderInterpolate(i + k, height, border);
+                rows[k + 1] = x < 0 ? zeros : image[x];
+            }
+
+            SobelColumn(kernels, rows, smooth + 1, deriv + 1, width);
+
+            // Заполняем отступы за левой и правой границей строки
+            smooth[0] = left < 0 ? 0 : smooth[left + 1];
+            deriv[0] = left < 0 ? 0 : deriv[left + 1];
+            smooth[width + 1] = right < 0 ? 0 : smooth[right + 1];
+            deriv[width + 1] = right < 0 ? 0 : deriv[right + 1];
+
+            kernels.sobelRowS16(smooth, deriv, gradX[i], gradY[i], width);
+        }
+    }, ROW_GRAIN);
+}
+
+void sobelOperator(ImageView<const uchar> image, ImageView<short> gradX, ImageView<short> gradY, BorderMode border)
+{
+    SobelInt(image, gradX, gradY, border);
+}
+
+// Наибольший модуль входа int16, при котором компоненты градиента (до 8 * v)
+// не выходят за пределы int16
+static const int SOBEL_S16_LIMIT = 4095;
+
+// Функция для проверки, что все значения изображения лежат в [-limit, limit]
+static bool InRange(ImageView<const short> image, int limit)
+{
+    std::atomic<bool> inRange(true);
+
+    ThreadPool::ParallelFor(0, image.rows(), [&](int begin, int end)
+    {
+        bool bandInRange = true;
+
+        for (int i = begin; i < end; i++)
+        {
+            const short* row = image[i];
+            for (int j = 0; j < image.cols(); j++)
+                bandInRange &= row[j] >= -limit && row[j] <= limit;
+        }
+
+        if (!bandInRange)
+            inRange = false;
+    }, 64);
+
+    return inRange;
+}
+
+void sobelOperator(ImageView<const short> image, ImageView<short> gradX, ImageView<short> gradY, BorderMode border)
+{
+    CV_Assert(InRange(image, SOBEL_S16_LIMIT));
+    SobelInt(image, gradX, gradY, border);
+}
+
+// Число шагов, на которые делится отношение min / max в табличном режиме
+static const int MAGNITUDE_TABLE_STEPS = 256;
+
+// Таблица sqrt(1 + t^2) для t = 0, 1 / 256, ..., 1
+static const float* MagnitudeTable()
+{
+    static const std::vector<float> table = []
+    {
+        std::vector<float> values(MAGNITUDE_TABLE_STEPS + 1);
+        for (int t = 0; t <= MAGNITUDE_TABLE_STEPS; t++)
+        {
+            double ratio = static_cast<double>(t) / MAGNITUDE_TABLE_STEPS;
+            values[t] = std::sqrt(1.0 + ratio * ratio);
+        }
+        return values;
+    }();
+
+    return table.data();
+}
+
+void gradientMagnitude(ImageView<const short> gradX, ImageView<const short> gradY, ImageView<float> magnitude,
+    GradientMagnitude mode)
+{
+    int width = gradX.cols();
+    const float* table = MagnitudeTable();
+
+    ThreadPool::ParallelFor(0, gradX.rows(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const short* gx = gradX[i];
+            const short* gy = gradY[i];
+            float* out = magnitude[i];
+
+            switch (mode)
+            {
+            case GradientMagnitude::L2:
+                for (int j = 0; j < width; j++)
+                    out[j] = std::sqrt(static_cast<float>(gx[j] * gx[j] + gy[j] * gy[j]));
+                break;
+
+            case GradientMagnitude::L1:
+                for (int j = 0; j < width; j++)
+                    out[j] = std::abs(gx[j]) + std::abs(gy[j]);
+                break;
+
+            case GradientMagnitude::Table:
+                for (int j = 0; j < width; j++)
+                {
+                    int a = std::abs(gx[j]);
+                    int b = std::abs(gy[j]);
+                    int maxValue = std::max(a, b);
+                    int minValue = std::min(a, b);
+                    int index = maxValue > 0 ? (minValue * MAGNITUDE_TABLE_STEPS + maxValue / 2) / maxValue : 0;
+
+                    out[j] = maxValue * table[index];
+                }
+                break;
+            }
+        }
+    }, 64);
+}
+
+// Функция для поиска максимального значения изображения
+// Отдельный проход по изображению нужен, только если максимум не был
+// найден при его построении (GaussianSobel, sobelOperator)
+static float ComputeMaxValue(ImageView<const float> image)
+{
+    BandMaximum maximum;
+
+    ThreadPool::ParallelFor(0, image.rows(), [&](int begin, int end)
+    {
+        float bandMax = 0.0f;
+
+        for (int i = begin; i < end; i++)
+            bandMax = RowMaximum(image[i], image.cols(), bandMax);
+
+        maximum.Merge(bandMax);
+    }, 64);
+
+    return maximum.value();
+}
+
+// Функция для перевода модуля градиента в uchar с масштабом 255 / maxValue.
+// Если histogram не равен nullptr, в нём накапливается гистограмма результата:
+// каждая полоса строк считает свою, после чего они суммируются
+static void QuantizeGradient(ImageView<const float> image, ImageView<uchar> res, float maxValue, int* histogram)
+{
+    float alpha = 255.0 / (maxValue + 1e-6);
+    int height = image.rows();
+    int width = image.cols();
+    std::mutex mutex;
+
+    ThreadPool::ParallelFor(0, height, [&](int begin, int end)
+    {
+        HistogramAccumulator accumulator;
+
+        for (int i = begin; i < end; i++)
+        {
+            const float* in = image[i];
+            uchar* out = res[i];
+
+            for (int j = 0; j < width; j++)
+                out[j] = static_cast<unsigned char>(in[j] * alpha);
+
+            if (histogram)
+                accumulator.AddRow(out, width);
+        }
+
+        if (histogram)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            accumulator.AddTo(histogram);
+        }
+    }, 64);
+}
+
+void convertScaleAbs(ImageView<const float> image, ImageView<unsigned char> res)
+{
+    QuantizeGradient(image, res, ComputeMaxValue(image), nullptr);
+}
+
+void convertScaleAbs(ImageView<const float> image, ImageView<uchar> res, std::vector<int>& histogram, float maxValue)
+{
+    if (maxValue < 0)
+        maxValue = ComputeMaxValue(image);
+
+    histogram.assign(256, 0);
+    QuantizeGradient(image, res, maxValue, histogram.data());
+}
+
+void convertScaleAbs(const std::vector<std::vector<float>>& image, std::vector<std::vector<unsigned char>>& res)
+{
+    Image<float> input = toImage(image);
+    Image<unsigned char> output(input.rows(), input.cols());
+
+    convertScaleAbs(input, output);
+    toVector(output, res);
+}
+
+float countPixConcentration(cv::Mat& img)
+{
+    unsigned char* img_data = img.data;
+    
+    cv::Size sizes = img.size();
+
+    unsigned int count = 0;
+
+    for (int k = 0; k < sizes.height; k++) {
+        for (int j = 0; j < sizes.width; j++) {
+            if (img_data[k * img.step + j] == 255)
+                count++;
+        }
+    }
+
+    return float(count) / (sizes.height * sizes.width);
+}
+
+float countPixConcentration(const IntegralImage& table, const cv::Rect& rect)
+{
+    return float(table.Count(rect)) / (rect.height * rect.width);
+}
+
+float countPixConcentration(const BitMask& mask, const cv::Rect& rect)
+{
+    int first = rect.x;
+    int last = rect.x + rect.width;
+    int firstWord = first >> 6;
+    int lastWord = (last - 1) >> 6;
+
+    // Маски крайних слов прямоугольника
+    uint64_t firstBits = ~uint64_t(0) << (first & 63);
+    uint64_t lastBits = ~uint64_t(0) >> (63 - ((last - 1) & 63));
+
+    unsigned int count = 0;
+
+    for (int k = rect.y; k < rect.y + rect.height; k++)
+    {
+        const uint64_t* row = mask.row(k);
+        for (int w = firstWord; w <= lastWord; w++)
+        {
+            uint64_t bits = row[w];
+            if (w == firstWord)
+                bits &= firstBits;
+            if (w == lastWord)
+                bits &= lastBits;
+            count += CountBits(bits);
+        }
+    }
+
+    return float(count) / (rect.height * rect.width);
+}
+
+
+void drawRectangle(cv::Mat& img, int x, int y, int endX, int endY)
 {
     cv::Point p1(x, y);
     cv::Point p2(endX, endY);
 
     rectangle(img, p1, p2, 
     cv::Scalar(0, 0, 255), 1, cv::LINE_8);
-}
\ No newline at end of file
+}
+
+
+RegionDetector::Config RegionDetector::DefaultConfig()
+{
+    return Config();
+}
+
+RegionDetector::RegionDetector(const Config& config)
+    : config_(config)
+{
+    histogram_.reserve(256);
+}
+
+void RegionDetector::Detect(ImageView<const uchar> image, std::vector<cv::Rect>& boxes)
+{
+    int rows = image.rows();
+    int cols = image.cols();
+
+    gradient_.create(rows, cols);
+    quantized_.create(rows, cols);
+    labels_.create(rows, cols);
+
+    float maxValue = GaussFilter::GaussianSobel(image, gradient_, config_.kernelSize, config_.sigma);
+    convertScaleAbs(gradient_, quantized_, histogram_, maxValue);
+    Binarization::OtsuThreshold(quantized_, mask_, histogram_, config_.thresholdDivisor);
+
+    Borders::CCA(mask_, labels_, stats_, config_.connectivity);
+    table_.Build(mask_);
+    RegionFilter::Apply(stats_, table_, config_.filter);
+
+    boxes.clear();
+    for (int i = 0; i < stats_.size(); i++)
+    {
+        boxes.push_back(cv::Rect(stats_.left[i], stats_.top[i],
+            stats_.right[i] - stats_.left[i] + 1, stats_.bottom[i] - stats_.top[i] + 1));
+    }
+}
+
+void RegionDetector::Detect(const cv::Mat& image, std::vector<cv::Rect>& boxes)
+{
+    if (image.channels() == 3)
+    {
+        cv::cvtColor(image, gray_, cv::COLOR_BGR2GRAY);
+        Detect(asView<uchar>(static_cast<const cv::Mat&>(gray_)), boxes);
+        return;
+    }
+
+    Detect(asView<uchar>(image), boxes);
+}
@@ -1,51 +1,478 @@
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <limits.h>
 #include <opencv2/opencv.hpp>
 
+#include "image.hpp"
+
+// Представление cv::Mat в виде ImageView без копирования пикселей.
+// Тип элементов матрицы должен соответствовать T, число каналов - 1.
+template <typename T>
+ImageView<T> asView(cv::Mat& mat)
+{
+    CV_Assert(mat.type() == cv::DataType<T>::type && mat.step % sizeof(T) == 0);
+    return ImageView<T>(reinterpret_cast<T*>(mat.data), mat.rows, mat.cols, mat.step / sizeof(T));
+}
+
+template <typename T>
+ImageView<const T> asView(const cv::Mat& mat)
+{
+    CV_Assert(mat.type() == cv::DataType<T>::type && mat.step % sizeof(T) == 0);
+    return ImageView<const T>(reinterpret_cast<const T*>(mat.data), mat.rows, mat.cols, mat.step / sizeof(T));
+}
+
+// Заголовок cv::Mat поверх чужого буфера; владение памятью не передаётся
+template <typename T>
+cv::Mat asMat(ImageView<T> view)
+{
+    typedef typename std::remove_const<T>::type Type;
+    return cv::Mat(view.rows(), view.cols(), cv::DataType<Type>::type,
+        const_cast<Type*>(view.data()), view.stride() * sizeof(T));
+}
+
+// Способ обработки пикселей за границей изображения
+enum class BorderMode
+{
+    Renormalize, // учитываются только пиксели изображения, результат нормируется по их весу
+    Replicate,   // aaa|abcd|ddd
+    Reflect,     // cb|abcd|cb, крайний пиксель не повторяется
+    Constant     // 000|abcd|000
+};
+
+int borderInterpolate(int p, int len, BorderMode border);
+
+// Накопитель гистограммы значений uchar (256 элементов).
+// Соседние пиксели попадают в четыре чередующихся банка, поэтому подряд идущие
+// одинаковые значения не ждут завершения предыдущего инкремента того же счётчика.
+// Для параллельной обработки каждый поток заводит собственный накопитель,
+// а результаты суммируются через AddTo.
+class HistogramAccumulator
+{
+private:
+    static const int BANK_COUNT = 4;
+    alignas(64) int bins_[BANK_COUNT][256];
+
+public:
+    HistogramAccumulator() { Reset(); }
+
+    void Reset();
+    void AddRow(const uchar* row, int count);
+    void AddImage(ImageView<const uchar> image);
+
+    // Прибавляет накопленные значения к histogram (256 элементов)
+    void AddTo(int* histogram) const;
+};
+
+// Гистограмма изображения: полосы строк обрабатываются параллельно
+// собственными накопителями, которые затем суммируются
+std::vector<int> computeHistogram(ImageView<const uchar> image);
+
 class Binarization
 {
 private:
-    std::vector<int> ComputeHistogram(const std::vector<std::vector<uchar>>& image);
-    std::vector<int> ComputeCumulativeSum(const std::vector<int>& input);
+    std::vector<int> ComputeHistogram(ImageView<const uchar> image);
     float ComputeMeanIntensity(const std::vector<int>& histogram);
-    float ComputeOtsuThreshold(const std::vector<std::vector<uchar>>& image);
-    void BinaryThreshold(const std::vector<std::vector<uchar>>& inputImage, std::vector<std::vector<uchar>>& outputImage, float threshold);
+    float ComputeOtsuThreshold(const std::vector<int>& histogram);
+    void BinaryThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage, float threshold);
+    void BinaryThreshold(ImageView<const uchar> inputImage, BitMask& outputMask, float threshold);
 
     Binarization() {};
 
 public:
+    static void OtsuThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage);
+    // Бинаризация с заранее вычисленной гистограммой inputImage (256 элементов),
+    // например полученной из convertScaleAbs
+    static void OtsuThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    const std::vector<int>& histogram);
     static void OtsuThreshold(const std::vector<std::vector<uchar>>& inputImage, std::vector<std::vector<uchar>>& outputImage);
+    // Бинаризация в упакованную маску (по биту на пиксель), размер outputMask
+    // устанавливается по inputImage. Порог Оцу делится на divisor
+    static void OtsuThreshold(ImageView<const uchar> inputImage, BitMask& outputMask);
+    static void OtsuThreshold(ImageView<const uchar> inputImage, BitMask& outputMask,
+    const std::vector<int>& histogram, double divisor = 2.4);
+
+    // Способ вычисления локального порога по среднему m и стандартному отклонению s в окне
+    enum class Method
+    {
+        // T = m + k * s
+        Niblack,
+        // T = m * (1 + k * (s / dynamicRange - 1))
+        Sauvola
+    };
+
+    // Локальная бинаризация: окно windowSize x windowSize (нечётный размер) с центром
+    // в пикселе, у границ - только его часть внутри изображения. Пиксель получает 255,
+    // если его значение строго больше порога T. Сумма и сумма квадратов в окне берутся
+    // из интегральных изображений, поэтому стоимость не зависит от размера окна.
+    // inputImage и outputImage могут совпадать
+    static void AdaptiveThreshold(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    Method method = Method::Sauvola, int windowSize = 15, float k = 0.2f, float dynamicRange = 128.0f);
+};
+
+// Статистика объектов связного компонентного анализа в виде структуры массивов:
+// элемент i относится к объекту с меткой i + 1. Границы прямоугольника
+// (left, top) - (right, bottom) включительные
+struct ComponentStats
+{
+    std::vector<int> area;
+    std::vector<int> left;
+    std::vector<int> top;
+    std::vector<int> right;
+    std::vector<int> bottom;
+    std::vector<double> centroidX;
+    std::vector<double> centroidY;
+    // Сумма значений изображения яркости по пикселям объекта
+    std::vector<long long> intensitySum;
+
+    int size() const { return area.size(); }
+    void resize(int count);
+};
+
+// Горизонтальный отрезок единичных пикселей [begin, end) строки row
+struct PixelRun
+{
+    int row;
+    int begin;
+    int end;
+};
+
+// Объекты в виде списков отрезков: отрезки объекта с меткой c + 1 лежат
+// в runs[offsets[c] .. offsets[c + 1]) в порядке обхода по строкам
+struct RunComponents
+{
+    std::vector<PixelRun> runs;
+    std::vector<int> offsets;
+
+    int size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+// Координаты (строка, столбец) пикселей объектов в сжатом построчном формате
+// (CSR): пиксели объекта с меткой c + 1 лежат в coords[offsets[c] .. offsets[c + 1])
+// в порядке обхода по строкам
+struct PixelLists
+{
+    std::vector<std::pair<int, int>> coords;
+    std::vector<int> offsets;
+
+    int size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    // Пиксели объекта с меткой c + 1
+    Span<const std::pair<int, int>> operator[](int c) const
+    {
+        return Span<const std::pair<int, int>>(coords.data() + offsets[c], offsets[c + 1] - offsets[c]);
+    }
 };
 
 class Borders
 {
+public:
+    // Связность пикселей объекта: только по сторонам или также по диагоналям
+    enum class Connectivity
+    {
+        Four = 4,
+        Eight = 8
+    };
+
 private:
-    bool CheckBoundary(int x, int y, int rows, int cols);
-    void BFS(int x, int y, int label, const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels);    
-    
+    template <typename Binary>
+    int LabelComponents(const Binary& binaryImg, ImageView<int> labels, Connectivity connectivity,
+    ComponentStats* stats, ImageView<const uchar> intensity);
+
+    template <typename Binary>
+    int LabelRuns(const Binary& binaryImg, RunComponents& components, Connectivity connectivity);
+
     Borders() {};
 
 public:
-    static void GetBoundingBox(const std::vector<std::pair<int, int>>& contour, int& minX, int& minY, int& maxX, int& maxY);
-    static void CCA(const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels);
+    static void GetBoundingBox(Span<const std::pair<int, int>> contour, int& minX, int& minY, int& maxX, int& maxY);
+    // Раскладывает пиксели карты меток (метки 1..count, фон 0) по объектам
+    // в два прохода: подсчёт пикселей каждой метки, затем запись на места,
+    // найденные префиксными суммами. Память lists переиспользуется
+    static void CollectPixels(ImageView<const int> labels, int count, PixelLists& lists);
+    // Связный компонентный анализ в два прохода с таблицей эквивалентностей
+    // (union-find). Метки объектов идут подряд с 1 в порядке первого пикселя
+    // при обходе по строкам, фон получает 0. Возвращает число объектов
+    static int CCA(ImageView<const uchar> binaryImg, ImageView<int> labels,
+    Connectivity connectivity = Connectivity::Eight);
+    // Разметка по упакованной маске: нулевые слова пропускаются целиком
+    static int CCA(const BitMask& binaryMask, ImageView<int> labels,
+    Connectivity connectivity = Connectivity::Eight);
+    // Разметка с подсчётом статистики объектов во время прохода. Если задано
+    // изображение яркости intensity того же размера, по нему считается intensitySum
+    static int CCA(ImageView<const uchar> binaryImg, ImageView<int> labels, ComponentStats& stats,
+    Connectivity connectivity = Connectivity::Eight, ImageView<const uchar> intensity = ImageView<const uchar>());
+    static int CCA(const BitMask& binaryMask, ImageView<int> labels, ComponentStats& stats,
+    Connectivity connectivity = Connectivity::Eight, ImageView<const uchar> intensity = ImageView<const uchar>());
+    // Разметка по отрезкам: строки разбиваются на отрезки единичных пикселей,
+    // пересекающиеся отрезки соседних строк объединяются. Память и время
+    // зависят от числа отрезков, а не от площади изображения. Нумерация
+    // объектов совпадает с CCA. Возвращает число объектов
+    static int RunCCA(const BitMask& binaryMask, RunComponents& components,
+    Connectivity connectivity = Connectivity::Eight);
+    static int RunCCA(ImageView<const uchar> binaryImg, RunComponents& components,
+    Connectivity connectivity = Connectivity::Eight);
+    static int CCA(const std::vector<std::vector<uchar>>& binaryImg, std::vector<std::vector<int>>& labels,
+    Connectivity connectivity = Connectivity::Eight);
+};
+
+// Интегральное изображение (таблица сумм) бинарного изображения размером
+// (rows + 1) x (cols + 1): элемент (i, j) - число единичных пикселей
+// в прямоугольнике из строк [0, i) и столбцов [0, j). Число единиц в любом
+// прямоугольнике получается по четырём элементам таблицы
+class IntegralImage
+{
+private:
+    Image<unsigned int> table_;
+
+    // Вертикальное накопление построчных префиксных сумм
+    void AccumulateColumns();
+
+public:
+    // Единицей считается пиксель 255. Память переиспользуется между вызовами
+    void Build(ImageView<const uchar> binaryImg);
+    void Build(const BitMask& mask);
+
+    int rows() const { return table_.rows() - 1; }
+    int cols() const { return table_.cols() - 1; }
+
+    // Число единичных пикселей в прямоугольнике rect
+    unsigned int Count(const cv::Rect& rect) const
+    {
+        const unsigned int* top = table_.row(rect.y);
+        const unsigned int* bottom = table_.row(rect.y + rect.height);
+        int right = rect.x + rect.width;
+
+        return bottom[right] - bottom[rect.x] - top[right] + top[rect.x];
+    }
+};
+
+// Отбор объектов по таблице статистики. Размеры объекта считаются между
+// крайними пикселями: ширина right - left, высота bottom - top. Заполненность -
+// доля единичных пикселей маски в прямоугольнике этого размера с углом (left, top)
+class RegionFilter
+{
+private:
+    RegionFilter() {};
+
+public:
+    struct Config
+    {
+        // Объект остаётся, если в нём не меньше minArea пикселей,
+        // а диагональ, обе стороны и заполненность строго больше порогов
+        int minArea = 5;
+        double minDiagonal = 5.0;
+        int minSide = 3;
+        double minFillRatio = 0.20;
+    };
+
+    // Пороги по умолчанию (те же, что у Config()): minArea 5, minDiagonal 5,
+    // minSide 3, minFillRatio 0.20
+    static Config DefaultConfig();
+
+    // Оставляет в stats только подходящие объекты, сохраняя их порядок.
+    // Геометрические условия проверяются одним проходом по столбцам таблицы,
+    // заполненность считается только для прошедших их объектов.
+    // После отбора индексы в stats больше не соответствуют меткам.
+    // Возвращает число оставшихся объектов
+    static int Apply(ComponentStats& stats, const BitMask& mask, const Config& config);
+    // Заполненность берётся из интегрального изображения маски за O(1) на объект
+    static int Apply(ComponentStats& stats, const IntegralImage& table, const Config& config);
+
+private:
+    template <typename Density>
+    static int Filter(ComponentStats& stats, const Density& density, const Config& config);
 };
 
 class GaussFilter
 {
 private:
-    std::vector<std::vector<float>> CreateGaussianKernel(int kernelSize, float sigma);
+    std::vector<float> CreateGaussianKernel1D(int kernelSize, float sigma);
+    const std::vector<float>& CachedGaussianKernel1D(int kernelSize, float sigma);
     GaussFilter() {};
     
 public:
+    // Способ вычисления размытия
+    enum class Engine
+    {
+        // Сепарабельная свёртка с ядром kernelSize, стоимость растёт с размером ядра
+        Kernel,
+        // Рекурсивный фильтр Янга - ван Влита: стоимость пикселя не зависит от sigma,
+        // kernelSize не используется. За границей продолжаются крайние пиксели
+        // (Replicate) или нули (Constant; Renormalize - с нормировкой по весу пикселей
+        // изображения, как у свёртки). При sigma < 2 и в режиме Reflect выполняется
+        // свёртка с ядром 2 * ceil(3 * sigma) + 1. Максимальное отклонение от такой
+        // свёртки на изображениях 0..255: на перепаде 0/255 - 4.7 уровня при sigma 2
+        // и 2.4..3.4 при sigma 3..10, на углу перепада - 8.5 и 4.3..6.2; на равномерном
+        // шуме - 4.1 при sigma 2, 2.4 при sigma 3, 1.5 при sigma 4 и 1.0 при sigma 10.
+        // В режиме Constant край изображения - тоже перепад: отклонение у края до 9
+        // уровней при sigma 2 и 4.5..6.5 при sigma 3..10
+        Recursive
+    };
+
+    static void GaussianBlur(ImageView<const float> inputImage, ImageView<float> outputImage,
+    int kernelSize, float sigma, BorderMode border = BorderMode::Renormalize, Engine engine = Engine::Kernel);
+    static void GaussianBlur(ImageView<const uchar> inputImage, ImageView<float> outputImage,
+    int kernelSize, float sigma, BorderMode border = BorderMode::Renormalize, Engine engine = Engine::Kernel);
+
+    // Размытие с ядром K x K, размер которого известен при компиляции (K = 3, 5, 7, 9),
+    // что позволяет развернуть циклы по коэффициентам. Для этих размеров
+    // вызывается и из GaussianBlur с движком Kernel.
+    template <int K>
+    static void GaussianBlur(ImageView<const float> inputImage, ImageView<float> outputImage,
+    float sigma, BorderMode border = BorderMode::Renormalize);
+    template <int K>
+    static void GaussianBlur(ImageView<const uchar> inputImage, ImageView<float> outputImage,
+    float sigma, BorderMode border = BorderMode::Renormalize);
+
+    // Размытие в целых числах без перехода к float: коэффициенты ядра в формате Q8
+    // для горизонтального прохода и Q16 для вертикального, промежуточный
+    // результат - uint16 (значение * 256).
+    // Результат - округлённое значение 0..255 в uint8 или int16 (вход для
+    // целочисленного оператора Собеля). Отличие от округлённого результата
+    // версии с выходом float - не больше 1 при sigma до 2.5; при больших sigma
+    // крайние коэффициенты Q8 становятся грубыми и отличие достигает 2 - 3
+    static void GaussianBlur(ImageView<const uchar> inputImage, ImageView<uchar> outputImage,
+    int kernelSize, float sigma, BorderMode border = BorderMode::Renormalize);
+    static void GaussianBlur(ImageView<const uchar> inputImage, ImageView<short> outputImage,
+    int kernelSize, float sigma, BorderMode border = BorderMode::Renormalize);
+
+    // Размытие с ядром kernelSize и модуль градиента оператора Собеля 3x3 за один
+    // проход без промежуточного размытого изображения: в памяти находятся только
+    // kernelSize + 5 строк на поток. Результат совпадает с вызовом GaussianBlur
+    // (движок Kernel, режим blurBorder), за которым следует sobelOperator(sobelBorder).
+    // Возвращает максимум модуля градиента, найденный при записи строк, - его
+    // можно передать в convertScaleAbs вместо отдельного прохода по magnitude
+    static float GaussianSobel(ImageView<const float> image, ImageView<float> magnitude,
+    int kernelSize, float sigma, BorderMode blurBorder = BorderMode::Renormalize, BorderMode sobelBorder = BorderMode::Constant);
+    static float GaussianSobel(ImageView<const uchar> image, ImageView<float> magnitude,
+    int kernelSize, float sigma, BorderMode blurBorder = BorderMode::Renormalize, BorderMode sobelBorder = BorderMode::Constant);
     static void GaussianBlur(const std::vector<std::vector<float>>& inputImage, std::vector<std::vector<float>>& outputImage,
     int kernelSize, float sigma); 
 };
 
+Image<float> sobelOperator(ImageView<const float> image, BorderMode border = BorderMode::Constant);
+
+// Оператор Собеля с апертурой K x K (K = 3, 5, 7, 9); коэффициенты ядра
+// вычисляются при компиляции, циклы по ним разворачиваются
+template <int K>
+Image<float> sobelOperator(ImageView<const float> image, BorderMode border = BorderMode::Constant);
+
+// Квантованное направление градиента; в скобках - соседи пикселя (i, j)
+// вдоль градиента, с которыми он сравнивается при утончении границ
+enum class GradientOrientation : uchar
+{
+    // (i, j - 1), (i, j + 1)
+    Horizontal = 0,
+    // (i + 1, j - 1), (i - 1, j + 1)
+    AntiDiagonal = 1,
+    // (i - 1, j), (i + 1, j)
+    Vertical = 2,
+    // (i - 1, j - 1), (i + 1, j + 1)
+    Diagonal = 3
+};
+
+// Оператор Собеля 3x3 с записью результата в буферы вызывающего кода, без выделения
+// памяти. gradX, gradY (компоненты градиента) и orientation (коды GradientOrientation)
+// необязательны: пустые представления не заполняются. Размеры непустых буферов
+// должны совпадать с размером image
+void sobelOperator(ImageView<const float> image, ImageView<float> magnitude,
+    ImageView<float> gradX = ImageView<float>(), ImageView<float> gradY = ImageView<float>(),
+    ImageView<uchar> orientation = ImageView<uchar>(), BorderMode border = BorderMode::Constant);
+
+// Оператор Собеля с апертурой kernelSize x kernelSize (нечётный размер не меньше 3);
+// для размеров 3, 5, 7, 9 вызывает sobelOperator<K>. Если maxValue не nullptr,
+// в него записывается максимум модуля градиента
+Image<float> sobelOperator(ImageView<const float> image, int kernelSize, BorderMode border = BorderMode::Constant,
+    float* maxValue = nullptr);
 std::vector<std::vector<float>> sobelOperator(std::vector<std::vector<float>>& image);
 
+// Способ вычисления модуля градиента по компонентам gx, gy
+enum class GradientMagnitude
+{
+    // sqrt(gx^2 + gy^2)
+    L2,
+    // |gx| + |gy|
+    L1,
+    // max * sqrt(1 + (min / max)^2) со значением корня из таблицы на 257 элементов,
+    // относительная погрешность не больше 0.1% (0.098% на всём диапазоне int16)
+    Table
+};
+
+// Целочисленный сепарабельный оператор Собеля 3x3 ([1 2 1] x [1 0 -1]):
+// компоненты градиента записываются в gradX и gradY того же размера, что image.
+// Знаки и границы - как у sobelOperator для float. Для входа int16
+// значения должны быть в диапазоне -4095..4095 (|gx|, |gy| <= 8 * 4095 помещаются
+// в int16), иначе срабатывает CV_Assert
+void sobelOperator(ImageView<const uchar> image, ImageView<short> gradX, ImageView<short> gradY,
+    BorderMode border = BorderMode::Constant);
+void sobelOperator(ImageView<const short> image, ImageView<short> gradX, ImageView<short> gradY,
+    BorderMode border = BorderMode::Constant);
+
+// Модуль градиента по компонентам, найденным целочисленным оператором Собеля
+void gradientMagnitude(ImageView<const short> gradX, ImageView<const short> gradY, ImageView<float> magnitude,
+    GradientMagnitude mode = GradientMagnitude::L2);
+
+// Перевод модуля градиента в uchar: значения масштабируются так,
+// что максимальное значение изображения переходит в 255
+void convertScaleAbs(ImageView<const float> image, ImageView<uchar> res);
+// То же, с гистограммой результата (256 элементов), которая накапливается
+// за тот же проход. maxValue - максимум image, если он уже известен (его возвращают
+// GaussianSobel и sobelOperator); при maxValue < 0 он находится отдельным проходом
+void convertScaleAbs(ImageView<const float> image, ImageView<uchar> res, std::vector<int>& histogram,
+    float maxValue = -1);
 void convertScaleAbs(const std::vector<std::vector<float>>& image, std::vector<std::vector<uchar>>& res);
 
 float countPixConcentration(cv::Mat& img);
+// Доля единичных пикселей маски внутри прямоугольника rect
+float countPixConcentration(const BitMask& mask, const cv::Rect& rect);
+// То же по интегральному изображению: четыре обращения к таблице
+float countPixConcentration(const IntegralImage& table, const cv::Rect& rect);
+
+void drawRectangle(cv::Mat& img, int x, int y, int endX, int endY);
+
+// Поиск областей на изображении: размытие по Гауссу с оператором Собеля,
+// перевод модуля градиента в uchar, бинаризация методом Оцу, связный
+// компонентный анализ и отбор объектов. Промежуточные буферы хранятся в объекте
+// и переиспользуются, поэтому при обработке кадров одного размера память
+// не выделяется. Один объект нельзя использовать из нескольких потоков одновременно
+class RegionDetector
+{
+public:
+    struct Config
+    {
+        int kernelSize = 5;
+        float sigma = 1.0f;
+        // Делитель порога Оцу
+        double thresholdDivisor = 2.4;
+        Borders::Connectivity connectivity = Borders::Connectivity::Eight;
+        RegionFilter::Config filter;
+    };
 
-void drawRectangle(cv::Mat& img, int x, int y, int endX, int endY);
\ No newline at end of file
+    // Параметры по умолчанию (те же, что у Config()): ядро 5, sigma 1.0,
+    // делитель 2.4, 8-связность, пороги отбора RegionFilter::DefaultConfig
+    static Config DefaultConfig();
+
+    explicit RegionDetector(const Config& config = DefaultConfig());
+
+    // Находит прямоугольники областей на полутоновом изображении; прямоугольник
+    // включает крайние пиксели объекта. Память boxes переиспользуется
+    void Detect(ImageView<const uchar> image, std::vector<cv::Rect>& boxes);
+    // Изображение CV_8UC1 или CV_8UC3 (BGR, переводится в полутоновое)
+    void Detect(const cv::Mat& image, std::vector<cv::Rect>& boxes);
+
+    const Config& config() const { return config_; }
+    // Бинаризованное изображение последнего вызова Detect
+    const BitMask& mask() const { return mask_; }
+
+private:
+    Config config_;
+    cv::Mat gray_;
+    Image<float> gradient_;
+    Image<uchar> quantized_;
+    std::vector<int> histogram_;
+    BitMask mask_;
+    Image<int> labels_;
+    ComponentStats stats_;
+    IntegralImage table_;
+};
\ No newline at end of file